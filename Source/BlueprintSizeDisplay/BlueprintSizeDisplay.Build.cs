@@ -45,7 +45,8 @@ public class BlueprintSizeDisplay : ModuleRules
 				"Kismet",
 				"UnrealEd",
                 "BlueprintEditorLibrary",
-				"Blutility"
+				"Blutility",
+				"Json"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,366 @@
+#include "BPSizeAuditCommandlet.h"
+
+#include "AssetManagerEditorModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "BPSizeGraph.h"
+#include "BPSizeGraphFile.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Blueprint.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBPSizeAudit, Log, All);
+
+UBPSizeAuditCommandlet::UBPSizeAuditCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int64 UBPSizeAuditCommandlet::FindBudget(const FName& PackageName) const
+{
+	const FString packageNameString = PackageName.ToString();
+
+	int64 budget = DefaultBudget;
+	int32 bestMatchLength = -1;
+	for (const TPair<FString, int64>& pathBudget : PathBudgets)
+	{
+		const FString& path = pathBudget.Key;
+		const bool isUnderPath = packageNameString.StartsWith(path)
+			&& (packageNameString.Len() == path.Len() || path.EndsWith(TEXT("/")) || packageNameString[path.Len()] == TEXT('/'));
+
+		if (isUnderPath && path.Len() > bestMatchLength)
+		{
+			budget = pathBudget.Value;
+			bestMatchLength = path.Len();
+		}
+	}
+
+	return budget;
+}
+
+bool UBPSizeAuditCommandlet::LoadBaseline(const FString& BaselineFile, TMap<FName, int64>& OutBaseline) const
+{
+	TArray<FString> lines;
+	if (!FFileHelper::LoadFileToStringArray(lines, *BaselineFile))
+	{
+		return false;
+	}
+
+	// Same layout as WriteCsv, the first line is the header
+	for (int32 lineIndex = 1; lineIndex < lines.Num(); ++lineIndex)
+	{
+		TArray<FString> columns;
+		lines[lineIndex].ParseIntoArray(columns, TEXT(","), false);
+		if (columns.Num() >= 2)
+		{
+			OutBaseline.Add(FName(*columns[0]), FCString::Atoi64(*columns[1]));
+		}
+	}
+
+	return true;
+}
+
+bool UBPSizeAuditCommandlet::WriteCsv(const FString& CsvFile, const TArray<FAuditEntry>& Entries) const
+{
+	FString csv = TEXT("Package,Size,ExclusiveSize,HasKnownSize,Dependencies,Budget,BaselineSize,OverBudget,GrewTooMuch\n");
+	for (const FAuditEntry& entry : Entries)
+	{
+		csv += FString::Printf(TEXT("%s,%lld,%lld,%d,%d,%lld,%lld,%d,%d\n"),
+			*entry.PackageName.ToString(),
+			entry.Size,
+			entry.ExclusiveSize,
+			entry.HasKnownSize ? 1 : 0,
+			entry.NumDependencies,
+			entry.Budget,
+			entry.BaselineSize,
+			entry.OverBudget ? 1 : 0,
+			entry.GrewTooMuch ? 1 : 0);
+	}
+
+	return FFileHelper::SaveStringToFile(csv, *CsvFile);
+}
+
+bool UBPSizeAuditCommandlet::WriteJson(const FString& JsonFile, const TArray<FAuditEntry>& Entries, int64 OverlapSize, double TotalSeconds) const
+{
+	TArray<TSharedPtr<FJsonValue>> jsonEntries;
+	jsonEntries.Reserve(Entries.Num());
+
+	for (const FAuditEntry& entry : Entries)
+	{
+		TSharedRef<FJsonObject> jsonEntry = MakeShared<FJsonObject>();
+		jsonEntry->SetStringField(TEXT("package"), entry.PackageName.ToString());
+		jsonEntry->SetNumberField(TEXT("size"), entry.Size);
+		jsonEntry->SetNumberField(TEXT("exclusiveSize"), entry.ExclusiveSize);
+		jsonEntry->SetBoolField(TEXT("hasKnownSize"), entry.HasKnownSize);
+		jsonEntry->SetNumberField(TEXT("dependencies"), entry.NumDependencies);
+		jsonEntry->SetNumberField(TEXT("budget"), entry.Budget);
+		jsonEntry->SetNumberField(TEXT("baselineSize"), entry.BaselineSize);
+		jsonEntry->SetBoolField(TEXT("overBudget"), entry.OverBudget);
+		jsonEntry->SetBoolField(TEXT("grewTooMuch"), entry.GrewTooMuch);
+		jsonEntries.Add(MakeShared<FJsonValueObject>(jsonEntry));
+	}
+
+	TSharedRef<FJsonObject> jsonRoot = MakeShared<FJsonObject>();
+	jsonRoot->SetNumberField(TEXT("overlapSize"), OverlapSize);
+	jsonRoot->SetNumberField(TEXT("computeMs"), TotalSeconds * 1000.0);
+	jsonRoot->SetArrayField(TEXT("blueprints"), jsonEntries);
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	if (!FJsonSerializer::Serialize(jsonRoot, writer))
+	{
+		return false;
+	}
+
+	return FFileHelper::SaveStringToFile(json, *JsonFile);
+}
+
+bool UBPSizeAuditCommandlet::SizeFromRegistry(
+	const TArray<FString>& ContentPaths,
+	const FName& SizeType,
+	const FString* ExportFile,
+	TArray<FName>& OutPackageNames,
+	FBPSizeBatchResult& OutResult,
+	int32& OutSizeTypeIndex,
+	double& OutTotalSeconds) const
+{
+	IAssetRegistry& assetRegistry = IAssetRegistry::GetChecked();
+	assetRegistry.SearchAllAssets(true);
+
+	FARFilter filter;
+	for (const FString& contentPath : ContentPaths)
+	{
+		filter.PackagePaths.Add(FName(*contentPath));
+	}
+	filter.bRecursivePaths = true;
+	filter.ClassPaths.Add(UBlueprint::StaticClass()->GetClassPathName());
+	filter.bRecursiveClasses = true;
+
+	TArray<FAssetData> blueprintAssets;
+	assetRegistry.GetAssets(filter, blueprintAssets);
+
+	TSet<FName> uniquePackageNames;
+	uniquePackageNames.Reserve(blueprintAssets.Num());
+	for (const FAssetData& blueprintAsset : blueprintAssets)
+	{
+		uniquePackageNames.Add(blueprintAsset.PackageName);
+	}
+	OutPackageNames = uniquePackageNames.Array();
+
+	IAssetManagerEditorModule& editorModule = IAssetManagerEditorModule::Get();
+	const FAssetManagerEditorRegistrySource* registrySource = editorModule.GetCurrentRegistrySource(true);
+	if (!registrySource || !registrySource->HasRegistry())
+	{
+		UE_LOG(LogBPSizeAudit, Error, TEXT("No asset registry to audit"));
+		return false;
+	}
+
+	UE_LOG(LogBPSizeAudit, Display, TEXT("Sizing %d blueprints under %s"), OutPackageNames.Num(), *FString::Join(ContentPaths, TEXT(", ")));
+
+	// One traversal for all the blueprints and all size types, so shared dependencies are only resolved once
+	const double startTime = FPlatformTime::Seconds();
+	FBPSizeGraph sizeGraph(editorModule, *registrySource);
+	OutSizeTypeIndex = sizeGraph.FindOrAddSizeType(SizeType);
+	sizeGraph.CalculateClosureSizes(OutPackageNames, OutResult);
+	OutTotalSeconds = FPlatformTime::Seconds() - startTime;
+
+	if (ExportFile)
+	{
+		// The traversal already has the standard size types and the audited one, so a replay can use any of them
+		FBPSizeGraphFile graphFile;
+		graphFile.RootPackageNames = OutPackageNames;
+		graphFile.Capture(*sizeGraph.GetSnapshot(), sizeGraph.GetPackageNames());
+
+		if (!graphFile.Save(*ExportFile))
+		{
+			UE_LOG(LogBPSizeAudit, Error, TEXT("Failed to write the graph snapshot %s"), **ExportFile);
+			return false;
+		}
+		UE_LOG(LogBPSizeAudit, Display, TEXT("Wrote %d packages and %d dependencies to %s"), graphFile.PackageNames.Num(), graphFile.DependencyIndices.Num(), **ExportFile);
+	}
+
+	return true;
+}
+
+bool UBPSizeAuditCommandlet::SizeFromSnapshot(
+	const FString& SnapshotFile,
+	const TArray<FString>& ContentPaths,
+	const FName& SizeType,
+	TArray<FName>& OutPackageNames,
+	FBPSizeBatchResult& OutResult,
+	int32& OutSizeTypeIndex,
+	double& OutTotalSeconds) const
+{
+	FBPSizeGraphFile graphFile;
+	if (!graphFile.Load(SnapshotFile))
+	{
+		UE_LOG(LogBPSizeAudit, Error, TEXT("Failed to read the graph snapshot %s"), *SnapshotFile);
+		return false;
+	}
+
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = graphFile.MakeSnapshot();
+	OutSizeTypeIndex = snapshot->FindSizeType(SizeType);
+	if (OutSizeTypeIndex == INDEX_NONE)
+	{
+		UE_LOG(LogBPSizeAudit, Error, TEXT("The graph snapshot %s has no %s sizes"), *SnapshotFile, *SizeType.ToString());
+		return false;
+	}
+
+	TArray<int32> rootIndices;
+	for (const FName& rootPackageName : graphFile.RootPackageNames)
+	{
+		const FString rootPackageNameString = rootPackageName.ToString();
+		const bool isUnderPath = ContentPaths.ContainsByPredicate([&rootPackageNameString](const FString& ContentPath)
+		{
+			return rootPackageNameString.StartsWith(ContentPath.EndsWith(TEXT("/")) ? ContentPath : ContentPath + TEXT("/"));
+		});
+
+		if (isUnderPath)
+		{
+			OutPackageNames.Add(rootPackageName);
+			rootIndices.Add(graphFile.FindPackage(rootPackageName));
+		}
+	}
+
+	UE_LOG(LogBPSizeAudit, Display, TEXT("Sizing %d blueprints from the graph snapshot %s"), OutPackageNames.Num(), *SnapshotFile);
+
+	// The snapshot is complete, so the batch needs no resolving and runs exactly as it would against the live graph
+	const double startTime = FPlatformTime::Seconds();
+	OutResult = snapshot->CalculateClosures(rootIndices);
+	OutTotalSeconds = FPlatformTime::Seconds() - startTime;
+
+	return true;
+}
+
+int32 UBPSizeAuditCommandlet::Main(const FString& Params)
+{
+	TArray<FString> tokens;
+	TArray<FString> switches;
+	TMap<FString, FString> params;
+	ParseCommandLine(*Params, tokens, switches, params);
+
+	TArray<FString> contentPaths;
+	if (const FString* pathsParam = params.Find(TEXT("Paths")))
+	{
+		pathsParam->ParseIntoArray(contentPaths, TEXT("+"));
+	}
+	if (contentPaths.IsEmpty())
+	{
+		contentPaths.Add(TEXT("/Game"));
+	}
+
+	const FString* sizeTypeParam = params.Find(TEXT("SizeType"));
+	const FName sizeType = sizeTypeParam ? FName(**sizeTypeParam) : IAssetManagerEditorModule::ResourceSizeName;
+
+	if (const FString* budgetParam = params.Find(TEXT("Budget")))
+	{
+		DefaultBudget = FCString::Atoi64(**budgetParam);
+	}
+
+	if (const FString* maxGrowthParam = params.Find(TEXT("MaxGrowth")))
+	{
+		MaxGrowthPercent = FCString::Atof(**maxGrowthParam);
+	}
+
+	TMap<FName, int64> baseline;
+	if (const FString* baselineParam = params.Find(TEXT("Baseline")))
+	{
+		if (!LoadBaseline(*baselineParam, baseline))
+		{
+			UE_LOG(LogBPSizeAudit, Error, TEXT("Failed to read the baseline file %s"), **baselineParam);
+			return 1;
+		}
+	}
+
+	TArray<FName> packageNames;
+	FBPSizeBatchResult batchResult;
+	int32 sizeTypeIndex = INDEX_NONE;
+	double totalSeconds = 0.0;
+
+	if (const FString* snapshotParam = params.Find(TEXT("Snapshot")))
+	{
+		if (!SizeFromSnapshot(*snapshotParam, contentPaths, sizeType, packageNames, batchResult, sizeTypeIndex, totalSeconds))
+		{
+			return 1;
+		}
+	}
+	else if (!SizeFromRegistry(contentPaths, sizeType, params.Find(TEXT("ExportSnapshot")), packageNames, batchResult, sizeTypeIndex, totalSeconds))
+	{
+		return 1;
+	}
+
+	TArray<FAuditEntry> entries;
+	entries.Reserve(packageNames.Num());
+	int32 numFailures = 0;
+
+	for (int32 packageOrdinal = 0; packageOrdinal < packageNames.Num(); ++packageOrdinal)
+	{
+		const FBPSizeClosureResult& closure = batchResult.Closures[packageOrdinal];
+
+		FAuditEntry& entry = entries.AddDefaulted_GetRef();
+		entry.PackageName = packageNames[packageOrdinal];
+		entry.Size = closure.Sizes[sizeTypeIndex];
+		entry.ExclusiveSize = batchResult.ExclusiveSizes[sizeTypeIndex][packageOrdinal];
+		entry.HasKnownSize = closure.HasKnownSizes[sizeTypeIndex];
+		entry.NumDependencies = FMath::Max(closure.NumPackages - 1, 0);
+		entry.Budget = FindBudget(entry.PackageName);
+
+		if (entry.Budget > 0 && entry.Size > entry.Budget)
+		{
+			entry.OverBudget = true;
+			UE_LOG(LogBPSizeAudit, Error, TEXT("%s is %lld bytes, over its budget of %lld bytes"), *entry.PackageName.ToString(), entry.Size, entry.Budget);
+		}
+
+		if (const int64* baselineSize = baseline.Find(entry.PackageName))
+		{
+			entry.BaselineSize = *baselineSize;
+
+			// Any size at all is unlimited growth over an empty baseline
+			const double growthPercent = *baselineSize > 0 ? 100.0 * (entry.Size - *baselineSize) / *baselineSize : 0.0;
+			if (MaxGrowthPercent > 0.0f && *baselineSize <= 0 && entry.Size > 0)
+			{
+				entry.GrewTooMuch = true;
+				UE_LOG(LogBPSizeAudit, Error, TEXT("%s grew from a baseline of %lld bytes to %lld bytes"),
+					*entry.PackageName.ToString(), *baselineSize, entry.Size);
+			}
+			else if (MaxGrowthPercent > 0.0f && growthPercent > MaxGrowthPercent)
+			{
+				entry.GrewTooMuch = true;
+				UE_LOG(LogBPSizeAudit, Error, TEXT("%s grew by %.1f%% since the baseline (%lld -> %lld bytes), more than the allowed %.1f%%"),
+					*entry.PackageName.ToString(), growthPercent, *baselineSize, entry.Size, MaxGrowthPercent);
+			}
+		}
+
+		if (entry.OverBudget || entry.GrewTooMuch)
+		{
+			++numFailures;
+		}
+	}
+
+	if (const FString* csvParam = params.Find(TEXT("Csv")))
+	{
+		if (!WriteCsv(*csvParam, entries))
+		{
+			UE_LOG(LogBPSizeAudit, Error, TEXT("Failed to write %s"), **csvParam);
+			++numFailures;
+		}
+	}
+
+	if (const FString* jsonParam = params.Find(TEXT("Json")))
+	{
+		if (!WriteJson(*jsonParam, entries, batchResult.OverlapSizes[sizeTypeIndex], totalSeconds))
+		{
+			UE_LOG(LogBPSizeAudit, Error, TEXT("Failed to write %s"), **jsonParam);
+			++numFailures;
+		}
+	}
+
+	UE_LOG(LogBPSizeAudit, Display, TEXT("Sized %d blueprints in %.2f s, %d failed the audit"), entries.Num(), totalSeconds, numFailures);
+
+	return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BPSizeGraph.h"
+#include "BPSizeAuditCommandlet.generated.h"
+
+// Sizes every blueprint under the given content paths in one shared traversal and fails when one of them is over budget.
+//
+// UnrealEditor-Cmd <Project> -run=BPSizeAudit -nullrhi [-Paths=/Game/A+/Game/B] [-SizeType=ResourceSize]
+//     [-Csv=<File>] [-Json=<File>] [-Baseline=<Csv from an earlier run>] [-MaxGrowth=<Percent>] [-Budget=<Bytes>]
+//     [-ExportSnapshot=<File>] [-Snapshot=<File>]
+//
+// -ExportSnapshot writes the traversed graph to a file, -Snapshot sizes the blueprints of such a file instead of the
+// project's asset registry, so slow cases can be profiled and reproduced without the project.
+//
+// Budgets can also be set per content path in the [/Script/BlueprintSizeDisplay.BPSizeAuditCommandlet] section of DefaultEditor.ini,
+// the longest matching path wins.
+UCLASS(config=Editor)
+class UBPSizeAuditCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBPSizeAuditCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FAuditEntry
+	{
+		FName PackageName;
+		int64 Size = 0;
+		int64 ExclusiveSize = 0;
+		bool HasKnownSize = false;
+		int32 NumDependencies = 0;
+		int64 Budget = 0;
+		int64 BaselineSize = -1;
+		bool OverBudget = false;
+		bool GrewTooMuch = false;
+	};
+
+	// Bytes, 0 means no budget
+	UPROPERTY(config)
+	int64 DefaultBudget = 0;
+
+	// Content path to budget in bytes
+	UPROPERTY(config)
+	TMap<FString, int64> PathBudgets;
+
+	// Allowed growth over the baseline in percent, 0 disables the check
+	UPROPERTY(config)
+	float MaxGrowthPercent = 0.0f;
+
+	bool SizeFromRegistry(
+		const TArray<FString>& ContentPaths,
+		const FName& SizeType,
+		const FString* ExportFile,
+		TArray<FName>& OutPackageNames,
+		FBPSizeBatchResult& OutResult,
+		int32& OutSizeTypeIndex,
+		double& OutTotalSeconds) const;
+
+	bool SizeFromSnapshot(
+		const FString& SnapshotFile,
+		const TArray<FString>& ContentPaths,
+		const FName& SizeType,
+		TArray<FName>& OutPackageNames,
+		FBPSizeBatchResult& OutResult,
+		int32& OutSizeTypeIndex,
+		double& OutTotalSeconds) const;
+
+	int64 FindBudget(const FName& PackageName) const;
+	bool LoadBaseline(const FString& BaselineFile, TMap<FName, int64>& OutBaseline) const;
+	bool WriteCsv(const FString& CsvFile, const TArray<FAuditEntry>& Entries) const;
+	// The blueprints share their closures, so only the time of the whole batch is reported
+	bool WriteJson(const FString& JsonFile, const TArray<FAuditEntry>& Entries, int64 OverlapSize, double TotalSeconds) const;
+};
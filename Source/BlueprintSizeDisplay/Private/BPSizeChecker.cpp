@@ -1,11 +1,119 @@
 #include "BPSizeChecker.h"
 
+#include "Algo/AllOf.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "BlueprintEditorContext.h"
+#include "BPSizeStats.h"
+#include "Editor.h"
 #include "Engine/AssetManager.h"
+#include "Engine/Blueprint.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/PackageName.h"
+#include "Misc/ScopeExit.h"
+#include "Serialization/ArchiveUObject.h"
+#include "Subsystems/AssetEditorSubsystem.h"
 #include "ToolMenus.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectHash.h"
+#include "UObject/UObjectIterator.h"
 
 namespace
 {
+	TAutoConsoleVariable<int32> CVarClosureThreads(
+		TEXT("BPSize.ClosureThreads"),
+		0,
+		TEXT("How many threads a closure walk gets split across. 0 uses every task graph worker, 1 walks on a single thread."));
+
+	TAutoConsoleVariable<float> CVarTickBudgetMs(
+		TEXT("BPSize.TickBudgetMs"),
+		2.0f,
+		TEXT("Milliseconds per frame the game thread may spend resolving packages and invalidating saved ones. 0 does all of it right away."));
+
+	TAutoConsoleVariable<float> CVarInvalidationDelay(
+		TEXT("BPSize.InvalidationDelay"),
+		0.25f,
+		TEXT("Seconds without any saves before the saved packages get invalidated, so a Save All is handled as one change."));
+
+	TAutoConsoleVariable<bool> CVarDependencyModes(
+		TEXT("BPSize.DependencyModes"),
+		false,
+		TEXT("Walk the closures along editor-only and soft references with every calculation, in the same pass as the hard one. Only a hard game walk is split across threads, so by default the other modes are only walked for GetAssetSoftReferencePotential."));
+
+	bool IsOverBudget(double EndTime)
+	{
+		return EndTime > 0.0 && FPlatformTime::Seconds() >= EndTime;
+	}
+
+	uint8 GetCalculationModes()
+	{
+		return CVarDependencyModes.GetValueOnGameThread() ? BPSizeDependencyModes::All : BPSizeDependencyModes::HardGame;
+	}
+
+	int32 GetNumClosureThreads()
+	{
+		const int32 numThreads = CVarClosureThreads.GetValueOnGameThread();
+		return numThreads > 0 ? numThreads : FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1);
+	}
+
+	FAutoConsoleCommand ClosureScalingCommand(
+		TEXT("BPSize.ClosureScaling"),
+		TEXT("Times the closure walk of a package with 1, 2, 4, 8 and 16 threads, the condensed closure, the size tree, the lazy tree and the dominator tree. Usage: BPSize.ClosureScaling <PackageName> [SizeType]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.IsEmpty())
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Usage: BPSize.ClosureScaling <PackageName> [SizeType]"));
+				return;
+			}
+
+			const FName sizeType = Args.IsValidIndex(1) ? FName(*Args[1]) : IAssetManagerEditorModule::ResourceSizeName;
+			for (TObjectIterator<UBPSizeChecker> it; it; ++it)
+			{
+				if (it->LogClosureScaling(FName(*Args[0]), sizeType))
+				{
+					return;
+				}
+			}
+
+			UE_LOG(LogTemp, Warning, TEXT("No initialized Blueprint Size Display checker found"));
+		}));
+
+	FAutoConsoleCommand ResultCacheStatsCommand(
+		TEXT("BPSize.ResultCacheStats"),
+		TEXT("Logs how much memory the cached results take and how many were evicted. Usage: BPSize.ResultCacheStats [reset]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const bool resetCounters = Args.IsValidIndex(0) && Args[0] == TEXT("reset");
+			for (TObjectIterator<UBPSizeChecker> it; it; ++it)
+			{
+				if (it->LogResultCacheStats(resetCounters))
+				{
+					return;
+				}
+			}
+
+			UE_LOG(LogTemp, Warning, TEXT("No initialized Blueprint Size Display checker found"));
+		}));
+
+	FAutoConsoleCommand SizeProviderStatsCommand(
+		TEXT("BPSize.SizeProviderStats"),
+		TEXT("Logs how many self size lookups were served from the cache. Usage: BPSize.SizeProviderStats [reset]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const bool resetCounters = Args.IsValidIndex(0) && Args[0] == TEXT("reset");
+			for (TObjectIterator<UBPSizeChecker> it; it; ++it)
+			{
+				if (it->LogSizeProviderStats(resetCounters))
+				{
+					return;
+				}
+			}
+
+			UE_LOG(LogTemp, Warning, TEXT("No initialized Blueprint Size Display checker found"));
+		}));
+
 	FString MakeBestSizeString(const SIZE_T SizeInBytes, const bool bHasKnownSize)
 	{
 		FText SizeText;
@@ -40,28 +148,88 @@ namespace
 
 		return SizeText.ToString();
 	}
+
+	// Collects the objects a cooked copy of the serialized objects would hard reference: editor-only and transient
+	// properties are skipped, soft references aren't objects and don't get collected either
+	class FGameReferenceCollector : public FArchiveUObject
+	{
+	public:
+		FGameReferenceCollector(TArray<UObject*>& InReferencedObjects)
+			: ReferencedObjects(InReferencedObjects)
+		{
+			ArIsObjectReferenceCollector = true;
+			ArIgnoreOuterRef = true;
+			ArIgnoreArchetypeRef = true;
+			SetFilterEditorOnly(true);
+		}
+
+		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override
+		{
+			return InProperty->IsEditorOnlyProperty() || InProperty->HasAnyPropertyFlags(CPF_Transient);
+		}
+
+		virtual FArchive& operator<<(UObject*& Object) override
+		{
+			if (Object)
+			{
+				ReferencedObjects.AddUnique(Object);
+			}
+			return *this;
+		}
+
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FGameReferenceCollector");
+		}
+
+	private:
+		TArray<UObject*>& ReferencedObjects;
+	};
 }
 
-void UBPSizeChecker::GatherDependenciesRecursively(
-	TMap<FAssetIdentifier, TSharedPtr<FTreeMapNodeData>>& VisitedAssetIdentifiers,
-	const TArray<FAssetIdentifier>& AssetIdentifiers,
+void UBPSizeChecker::GatherDependencies(
+	FSizeTreeBuild& Build,
+	TMap<FAssetIdentifier, FVisitedTreeMapNode>& VisitedAssetIdentifiers,
 	const FPrimaryAssetId& FilterPrimaryAsset,
-	const TSharedPtr<FTreeMapNodeData>& Node,
+	const TSharedPtr<FTreeMapNodeData>& RootTreeMapNode,
 	TSharedPtr<FTreeMapNodeData>& SharedRootNode,
-	int32& NumAssetsWhichFailedToLoad)
+	int32& NumAssetsWhichFailedToLoad,
+	FResolveGatherNode ResolveNode)
 {
-	if (!CurrentRegistrySource->HasRegistry())
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::GatherDependencies);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeGather);
+
+	// All the scratch arrays of the walk come from the thread's memory stack and are released in one go at the end
+	const int32 startMemStackBytes = FMemStack::Get().GetByteCount();
+	FMemMark MemMark(FMemStack::Get());
+	ON_SCOPE_EXIT
 	{
-		return;
-	}
-	for (const FAssetIdentifier& AssetIdentifier : AssetIdentifiers)
+		FBPSizeStats::Increment(FBPSizeStats::ECounter::BytesAllocated, FMemStack::Get().GetByteCount() - startMemStackBytes);
+	};
+
+	// Each frame stands for one level of what used to be recursion, so deep reference chains only grow this array
+	TArray<FGatherFrame, TMemStackAllocator<>> Frames;
+	Frames.Add(FGatherFrame { RootTreeMapNode, TArray<FAssetIdentifier, TMemStackAllocator<>>(Build.RootAssetIdentifiers), FilterPrimaryAsset, INDEX_NONE, 0 });
+	int32 NumRootLevelAssets = 0;
+
+	while (!Frames.IsEmpty())
 	{
+		FGatherFrame& Frame = Frames.Last();
+		if (!Frame.AssetIdentifiers.IsValidIndex(Frame.NextIndex))
+		{
+			Frames.Pop(false);
+			continue;
+		}
+
+		// Copy what we need out of the frame, pushing a new one may reallocate the array
+		const FAssetIdentifier AssetIdentifier = Frame.AssetIdentifiers[Frame.NextIndex++];
+		FBPSizeStats::Increment(FBPSizeStats::ECounter::NodesVisited);
+		const TSharedPtr<FTreeMapNodeData> Node = Frame.Node;
+		const FPrimaryAssetId FrameFilterPrimaryAsset = Frame.FilterPrimaryAsset;
+		const int32 MyRootLevelAsset = Frame.RootLevelAsset;
+
 		FName AssetPackageName = AssetIdentifier.IsPackage() ? AssetIdentifier.PackageName : NAME_None;
-		FString AssetPackageNameString = (AssetPackageName != NAME_None) ? AssetPackageName.ToString() : FString();
 		FPrimaryAssetId AssetPrimaryId = AssetIdentifier.GetPrimaryAssetId();
-		int32 ChunkId = UAssetManager::ExtractChunkIdFromPrimaryAssetId(AssetPrimaryId);
-		int32 FilterChunkId = UAssetManager::ExtractChunkIdFromPrimaryAssetId(FilterPrimaryAsset);
-		const FAssetManagerChunkInfo* FilterChunkInfo = FilterChunkId != INDEX_NONE ? CurrentRegistrySource->ChunkAssignments.Find(FilterChunkId) : nullptr;
 
 		// Only support packages and primary assets
 		if (AssetPackageName == NAME_None && !AssetPrimaryId.IsValid())
@@ -70,7 +238,7 @@ void UBPSizeChecker::GatherDependenciesRecursively(
 		}
 
 		// Don't bother showing code references
-		if (AssetPackageNameString.StartsWith(TEXT("/Script/")))
+		if (FBPSizePackageClassifier::IsScriptPackage(AssetPackageName))
 		{
 			continue;
 		}
@@ -81,7 +249,8 @@ void UBPSizeChecker::GatherDependenciesRecursively(
 		{
 			// OK, we've determined that this asset has already been referenced by something else in our tree.  We'll move it to a "shared" group
 			// so all of the assets that are referenced in multiple places can be seen together.
-			TSharedPtr<FTreeMapNodeData> ExistingNode = VisitedAssetIdentifiers[AssetIdentifier];
+			const FVisitedTreeMapNode& ExistingVisitedNode = VisitedAssetIdentifiers[AssetIdentifier];
+			TSharedPtr<FTreeMapNodeData> ExistingNode = ExistingVisitedNode.Node;
 
 			// Is the existing node not already under the "shared" group?  Note that it might still be (indirectly) under
 			// the "shared" group, in which case we'll still want to move it up to the root since we've figured out that it is
@@ -93,44 +262,21 @@ void UBPSizeChecker::GatherDependenciesRecursively(
 				// are referenced by other assets in the set -- we don't need to indicate they are shared explicitly
 				FTreeMapNodeData* ExistingNodeParent = ExistingNode->Parent;
 				check(ExistingNodeParent != nullptr);
-				const bool bExistingNodeIsAtRootLevel = ExistingNodeParent->Parent == nullptr || RootAssetIdentifiers.Contains(AssetIdentifier);
+				const bool bExistingNodeIsAtRootLevel = ExistingNodeParent->Parent == nullptr || Build.RootAssetIdentifiers.Contains(AssetIdentifier);
 				if (!bExistingNodeIsAtRootLevel)
 				{
 					// OK, the current asset (AssetIdentifier) is definitely not a root level asset, but its already in the tree
 					// somewhere as a non-shared, non-root level asset.  We need to make sure that this Node's reference is not from the
 					// same root-level asset as the ExistingNodeInTree.  Otherwise, there's no need to move it to a 'shared' group.
-					FTreeMapNodeData* MyParentNode = Node.Get();
-					check(MyParentNode != nullptr);
-					FTreeMapNodeData* MyRootLevelAssetNode = MyParentNode;
-					while (MyRootLevelAssetNode->Parent != nullptr && MyRootLevelAssetNode->Parent->Parent != nullptr)
-					{
-						MyRootLevelAssetNode = MyRootLevelAssetNode->Parent;
-					}
-					if (MyRootLevelAssetNode->Parent == nullptr)
-					{
-						// No root asset (Node must be a root level asset itself!)
-						MyRootLevelAssetNode = nullptr;
-					}
-
-					// Find the existing node's root level asset node
-					FTreeMapNodeData* ExistingNodeRootLevelAssetNode = ExistingNodeParent;
-					while (ExistingNodeRootLevelAssetNode->Parent->Parent != nullptr)
-					{
-						ExistingNodeRootLevelAssetNode = ExistingNodeRootLevelAssetNode->Parent;
-					}
-
-					// If we're being referenced by another node within the same asset, no need to move it to a 'shared' group.  
-					if (MyRootLevelAssetNode != ExistingNodeRootLevelAssetNode)
+					// Every node remembers the root-level asset it was created under, instead of walking the parent chains.
+					// This gives the same answer as the walk: a root-level asset's subtree is complete before the next one starts, and nodes
+					// moved to the "shared" group are only ever compared against later root-level assets.
+					if (MyRootLevelAsset != ExistingVisitedNode.RootLevelAsset)
 					{
 						// This asset was already referenced by something else (or was in our top level list of assets to display sizes for)
 						if (!SharedRootNode.IsValid())
 						{
-							// Find the root-most tree node
-							FTreeMapNodeData* RootNode = MyParentNode;
-							while (RootNode->Parent != nullptr)
-							{
-								RootNode = RootNode->Parent;
-							}
+							FTreeMapNodeData* RootNode = RootTreeMapNode.Get();
 
 							SharedRootNode = MakeShareable(new FTreeMapNodeData());
 							RootNode->Children.Add(SharedRootNode);
@@ -153,152 +299,184 @@ void UBPSizeChecker::GatherDependenciesRecursively(
 			Node->Children.Add(ChildTreeMapNode);
 			ChildTreeMapNode->Parent = Node.Get();	// Keep back-pointer to parent node
 
-			VisitedAssetIdentifiers.Add(AssetIdentifier, ChildTreeMapNode);
+			// Children of the tree root are the root-level assets, everything below them inherits the owner
+			const int32 ChildRootLevelAsset = MyRootLevelAsset == INDEX_NONE ? NumRootLevelAssets++ : MyRootLevelAsset;
+			VisitedAssetIdentifiers.Add(AssetIdentifier, FVisitedTreeMapNode { ChildTreeMapNode, ChildRootLevelAsset });
 
-			FNodeSizeMapData& NodeSizeMapData = NodeSizeMapDataMap.Add(ChildTreeMapNode);
+			FNodeSizeMapData& NodeSizeMapData = Build.NodeSizeMapDataMap.Add(ChildTreeMapNode);
+			TArray<FAssetIdentifier, TMemStackAllocator<>> ReferencedAssetIdentifiers;
+			FPrimaryAssetId ChildFilterPrimaryAsset = FrameFilterPrimaryAsset;
+			ResolveNode(AssetIdentifier, FrameFilterPrimaryAsset, NodeSizeMapData, ReferencedAssetIdentifiers, ChildFilterPrimaryAsset);
 
-			// Set some defaults for this node.  These will be used if we can't actually locate the asset.
-			if (AssetPackageName != NAME_None)
+			if (NodeSizeMapData.bIsValid)
 			{
-				NodeSizeMapData.AssetData.AssetName = AssetPackageName;
-				NodeSizeMapData.AssetData.AssetClassPath = FTopLevelAssetPath(TEXT("/None"), TEXT("MISSING!"));
-
-				const FString AssetPathString = AssetPackageNameString + TEXT(".") + FPackageName::GetLongPackageAssetName(AssetPackageNameString);
-				FAssetData FoundData = CurrentRegistrySource->GetAssetByObjectPath(FSoftObjectPath(AssetPathString));
-
-				if (FoundData.IsValid())
-				{
-					NodeSizeMapData.AssetData = MoveTemp(FoundData);
-				}
+				// Now visit all of the assets that we are referencing, before moving on to our siblings
+				Frames.Add(FGatherFrame {
+					ChildTreeMapNode,
+					MoveTemp(ReferencedAssetIdentifiers),
+					ChildFilterPrimaryAsset,
+					ChildRootLevelAsset,
+					0
+				});
 			}
 			else
 			{
-				NodeSizeMapData.AssetData = IAssetManagerEditorModule::CreateFakeAssetDataFromPrimaryAssetId(AssetPrimaryId);
+				++NumAssetsWhichFailedToLoad;
 			}
-			
-			NodeSizeMapData.AssetSize = 0;
-			NodeSizeMapData.bHasKnownSize = false;
+		}
+	}
+}
 
-			if (NodeSizeMapData.AssetData.IsValid())
-			{
-				FAssetManagerDependencyQuery DependencyQuery = FAssetManagerDependencyQuery::None();
-				if (AssetPackageName != NAME_None)
-				{
-					DependencyQuery.Categories = UE::AssetRegistry::EDependencyCategory::Package;
-					DependencyQuery.Flags = UE::AssetRegistry::EDependencyQuery::Hard;
-				}
-				else
-				{
-					DependencyQuery.Categories = UE::AssetRegistry::EDependencyCategory::Manage;
-					DependencyQuery.Flags = UE::AssetRegistry::EDependencyQuery::Direct;
-				}
+void UBPSizeChecker::ResolveGatherNode(
+	FSizeTreeBuild& Build,
+	const FAssetIdentifier& AssetIdentifier,
+	const FPrimaryAssetId& FilterPrimaryAsset,
+	FNodeSizeMapData& NodeSizeMapData,
+	TArray<FAssetIdentifier, TMemStackAllocator<>>& ReferencedAssetIdentifiers,
+	FPrimaryAssetId& ChildFilterPrimaryAsset)
+{
+	static const FTopLevelAssetPath MissingAssetClassPath(TEXT("/None"), TEXT("MISSING!"));
+
+	FName AssetPackageName = AssetIdentifier.IsPackage() ? AssetIdentifier.PackageName : NAME_None;
+	FPrimaryAssetId AssetPrimaryId = AssetIdentifier.GetPrimaryAssetId();
+	int32 ChunkId = UAssetManager::ExtractChunkIdFromPrimaryAssetId(AssetPrimaryId);
+	int32 FilterChunkId = UAssetManager::ExtractChunkIdFromPrimaryAssetId(FilterPrimaryAsset);
+
+	// Only needed until the size is known, the node keeps just the names
+	FAssetData FoundData;
+
+	// Set some defaults for this node.  These will be used if we can't actually locate the asset.
+	if (AssetPackageName != NAME_None)
+	{
+		NodeSizeMapData.AssetName = AssetPackageName;
+		NodeSizeMapData.AssetClassPath = MissingAssetClassPath;
+
+		FoundData = CurrentRegistrySource->GetAssetByObjectPath(FBPSizePackageClassifier::MakeMainAssetPath(AssetPackageName));
+
+		if (FoundData.IsValid())
+		{
+			NodeSizeMapData.bIsValid = true;
+			NodeSizeMapData.PackageName = FoundData.PackageName;
+			NodeSizeMapData.AssetName = FoundData.AssetName;
+			NodeSizeMapData.AssetClassPath = FoundData.AssetClassPath;
+		}
+	}
+	else
+	{
+		NodeSizeMapData.bIsValid = true;
+		NodeSizeMapData.PrimaryAssetId = AssetPrimaryId;
+	}
+	
+	NodeSizeMapData.AssetSize = 0;
+	NodeSizeMapData.bHasKnownSize = false;
+
+	if (NodeSizeMapData.bIsValid)
+	{
+		FAssetManagerDependencyQuery DependencyQuery = FAssetManagerDependencyQuery::None();
+		if (AssetPackageName != NAME_None)
+		{
+			DependencyQuery.Categories = UE::AssetRegistry::EDependencyCategory::Package;
+			DependencyQuery.Flags = UE::AssetRegistry::EDependencyQuery::Hard;
+		}
+		else
+		{
+			DependencyQuery.Categories = UE::AssetRegistry::EDependencyCategory::Manage;
+			DependencyQuery.Flags = UE::AssetRegistry::EDependencyQuery::Direct;
+		}
 
 /*
-				if (GetDefault<USizeMapSettings>()->DependencyType == ESizeMapDependencyType::EditorOnly)
-				{
-					DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::EditorOnly;
-				}
-				else if (GetDefault<USizeMapSettings>()->DependencyType == ESizeMapDependencyType::Game)
-				{
-					DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::Game;
-				}
+		if (GetDefault<USizeMapSettings>()->DependencyType == ESizeMapDependencyType::EditorOnly)
+		{
+			DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::EditorOnly;
+		}
+		else if (GetDefault<USizeMapSettings>()->DependencyType == ESizeMapDependencyType::Game)
+		{
+			DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::Game;
+		}
 */
-				
-//				DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::EditorOnly;
-				DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::Game;
+		
+//		DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::EditorOnly;
+		DependencyQuery.Flags |= UE::AssetRegistry::EDependencyQuery::Game;
 
-				TArray<FAssetIdentifier> References;
-				
-				if (ChunkId != INDEX_NONE)
-				{
-					// Look in the platform state
-					const FAssetManagerChunkInfo* FoundChunkInfo = CurrentRegistrySource->ChunkAssignments.Find(ChunkId);
-					if (FoundChunkInfo)
-					{
-						References.Append(FoundChunkInfo->ExplicitAssets.Array());
-					}
-				}
-				else
-				{
-					CurrentRegistrySource->GetDependencies(AssetIdentifier, References, DependencyQuery.Categories, DependencyQuery.Flags);
-				}
-				
-				// Filter for registry source
-				IAssetManagerEditorModule::Get().FilterAssetIdentifiersForCurrentRegistrySource(References, DependencyQuery, true);
+		Build.References.Reset();
+		
+		if (ChunkId != INDEX_NONE)
+		{
+			// Look in the platform state
+			if (const TArray<FAssetIdentifier>* ExplicitAssets = ChunkIndex->FindExplicitAssets(ChunkId))
+			{
+				Build.References.Append(*ExplicitAssets);
+			}
+		}
+		else
+		{
+			CurrentRegistrySource->GetDependencies(AssetIdentifier, Build.References, DependencyQuery.Categories, DependencyQuery.Flags);
+			FBPSizeStats::Increment(FBPSizeStats::ECounter::DependencyQueries);
+		}
+		
+		// Filter for registry source
+		IAssetManagerEditorModule::Get().FilterAssetIdentifiersForCurrentRegistrySource(Build.References, DependencyQuery, true);
 
-				TArray<FAssetIdentifier> ReferencedAssetIdentifiers;
+		for (FAssetIdentifier& FoundAssetIdentifier : Build.References)
+		{
+			if (FoundAssetIdentifier.IsPackage())
+			{
+				FName FoundPackageName = FoundAssetIdentifier.PackageName;
 
-				for (FAssetIdentifier& FoundAssetIdentifier : References)
+				if (FoundPackageName != NAME_None)
 				{
-					if (FoundAssetIdentifier.IsPackage())
+					if (FilterChunkId != INDEX_NONE)
 					{
-						FName FoundPackageName = FoundAssetIdentifier.PackageName;
-
-						if (FoundPackageName != NAME_None)
+						if (!ChunkIndex->IsPackageInChunk(FoundPackageName, FilterChunkId))
 						{
-							if (FilterChunkId != INDEX_NONE)
-							{
-								if (!FilterChunkInfo || !FilterChunkInfo->AllAssets.Contains(FoundPackageName))
-								{
-									// Not found in the chunk list, skip
-									continue;
-								}
-							} 
-							else if (FilterPrimaryAsset.IsValid())
-							{
-								// Check to see if this is managed by the filter asset
-								TArray<FAssetIdentifier> Managers;
-								CurrentRegistrySource->GetReferencers(FoundAssetIdentifier, Managers, UE::AssetRegistry::EDependencyCategory::Manage);
-
-								if (!Managers.Contains(FilterPrimaryAsset))
-								{
-									continue;
-								}
-							}
-
-							ReferencedAssetIdentifiers.Add(FoundPackageName);
+							// Not found in the chunk list, skip
+							continue;
 						}
-					}
-					else
+					} 
+					else if (FilterPrimaryAsset.IsValid())
 					{
-						ReferencedAssetIdentifiers.Add(FoundAssetIdentifier);
+						// Check to see if this is managed by the filter asset
+						if (!ManagerIndex->IsManagedBy(FoundPackageName, FilterPrimaryAsset))
+						{
+							continue;
+						}
 					}
-				}
-				int64 FoundSize = 0;
 
-				if (AssetPackageName != NAME_None)
-				{
-					if (EditorModule->GetIntegerValueForCustomColumn(NodeSizeMapData.AssetData, SizeType, FoundSize))
-					{
-						// If we're reading cooked data, this will fail for dependencies that are editor only. This is fine, they will have 0 size
-						NodeSizeMapData.AssetSize = FoundSize;
-						NodeSizeMapData.bHasKnownSize = true;
-					}
-				}
-				else
-				{
-					// Virtual node, size is known to be 0
-					NodeSizeMapData.bHasKnownSize = true;
+					ReferencedAssetIdentifiers.Add(FoundPackageName);
 				}
-
-				// Now visit all of the assets that we are referencing
-				GatherDependenciesRecursively(
-					VisitedAssetIdentifiers,
-					ReferencedAssetIdentifiers,
-					ChunkId != INDEX_NONE ? AssetPrimaryId : FilterPrimaryAsset,
-					ChildTreeMapNode,
-					SharedRootNode,
-					NumAssetsWhichFailedToLoad);
 			}
 			else
 			{
-				++NumAssetsWhichFailedToLoad;
+				ReferencedAssetIdentifiers.Add(FoundAssetIdentifier);
+			}
+		}
+		int64 FoundSize = 0;
+
+		if (AssetPackageName != NAME_None)
+		{
+			const bool bFoundSize = SizeGraph
+				? SizeGraph->GetSizeProvider().GetSize(FoundData, Build.SizeType, FoundSize)
+				: EditorModule->GetIntegerValueForCustomColumn(FoundData, Build.SizeType, FoundSize);
+			if (bFoundSize)
+			{
+				// If we're reading cooked data, this will fail for dependencies that are editor only. This is fine, they will have 0 size
+				NodeSizeMapData.AssetSize = FoundSize;
+				NodeSizeMapData.bHasKnownSize = true;
 			}
 		}
+		else
+		{
+			// Virtual node, size is known to be 0
+			NodeSizeMapData.bHasKnownSize = true;
+		}
+
+		// Everything below a chunk is filtered by that chunk
+		ChildFilterPrimaryAsset = ChunkId != INDEX_NONE ? AssetPrimaryId : FilterPrimaryAsset;
 	}
 }
 
 void UBPSizeChecker::FinalizeNodesRecursively(
+	FSizeTreeBuild& Build,
 	TSharedPtr<FTreeMapNodeData>& Node,
 	const TSharedPtr<FTreeMapNodeData>& SharedRootNode,
 	int32& TotalAssetCount,
@@ -312,7 +490,7 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 	{
 		for (TSharedPtr<FTreeMapNodeData> ChildNode : Node->Children)
 		{
-			FinalizeNodesRecursively(ChildNode, SharedRootNode, SubtreeAssetCount, SubtreeSize, bAnyUnknownSizesInSubtree);
+			FinalizeNodesRecursively(Build, ChildNode, SharedRootNode, SubtreeAssetCount, SubtreeSize, bAnyUnknownSizesInSubtree);
 		}
 
 		TotalAssetCount += SubtreeAssetCount;
@@ -340,8 +518,8 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 	else
 	{
 		// Make a copy as the map may get resized
-		FNodeSizeMapData NodeSizeMapData = NodeSizeMapDataMap.FindChecked(Node.ToSharedRef());
-		FPrimaryAssetId PrimaryAssetId = IAssetManagerEditorModule::ExtractPrimaryAssetIdFromFakeAssetData(NodeSizeMapData.AssetData);
+		FNodeSizeMapData NodeSizeMapData = Build.NodeSizeMapDataMap.FindChecked(Node.ToSharedRef());
+		const FPrimaryAssetId& PrimaryAssetId = NodeSizeMapData.PrimaryAssetId;
 
 		++TotalAssetCount;
 		TotalSize += NodeSizeMapData.AssetSize;
@@ -376,7 +554,7 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 		}
 		else
 		{
-			Node->LogicalName = NodeSizeMapData.AssetData.PackageName.ToString();
+			Node->LogicalName = NodeSizeMapData.PackageName.ToString();
 		}
 		
 		if (Node->IsLeafNode())
@@ -404,8 +582,8 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 			{
 				// "Asset name"
 				// "Asset type"
-				Node->Name = NodeSizeMapData.AssetData.AssetName.ToString();
-				Node->Name2 = NodeSizeMapData.AssetData.AssetClassPath.ToString();
+				Node->Name = NodeSizeMapData.AssetName.ToString();
+				Node->Name2 = NodeSizeMapData.AssetClassPath.ToString();
 			}
 		}
 		else
@@ -423,8 +601,8 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 			{
 				// "Asset name (asset type, size)"
 				Node->Name = FString::Printf(TEXT("%s  (%s, %s)"),
-					*NodeSizeMapData.AssetData.AssetName.ToString(),
-					*NodeSizeMapData.AssetData.AssetClassPath.ToString(),
+					*NodeSizeMapData.AssetName.ToString(),
+					*NodeSizeMapData.AssetClassPath.ToString(),
 					*MakeBestSizeString(SubtreeSize + NodeSizeMapData.AssetSize, !bAnyUnknownSizesInSubtree && NodeSizeMapData.bHasKnownSize));
 			}
 
@@ -437,12 +615,12 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 				ChildSelfTreeMapNode->Parent = Node.Get();	// Keep back-pointer to parent node
 
 				// Map the "self" node to the same node data as its parent
-				NodeSizeMapDataMap.Add(ChildSelfTreeMapNode, NodeSizeMapData);
+				Build.NodeSizeMapDataMap.Add(ChildSelfTreeMapNode, NodeSizeMapData);
 
 				// "*SELF*"
 				// "Asset type"
 				ChildSelfTreeMapNode->Name = TEXT("*SELF*");
-				ChildSelfTreeMapNode->Name2 = NodeSizeMapData.AssetData.AssetClassPath.ToString();
+				ChildSelfTreeMapNode->Name2 = NodeSizeMapData.AssetClassPath.ToString();
 
 				ChildSelfTreeMapNode->CenterText = MakeBestSizeString(NodeSizeMapData.AssetSize, NodeSizeMapData.bHasKnownSize);
 				ChildSelfTreeMapNode->Size = NodeSizeMapData.AssetSize;
@@ -464,124 +642,1222 @@ void UBPSizeChecker::FinalizeNodesRecursively(
 	);
 }
 
-const UBPSizeChecker::FAssetSizeData& UBPSizeChecker::CalculateAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate)
+TSharedPtr<FTreeMapNodeData> UBPSizeChecker::BuildAssetSizeTree(const FName& PackageName, const FName& SizeTypeToCalculate)
 {
-	bool sizeDataJustCreated = false;
-	if (!FileSizeDataCache.Contains(PackageName))
-	{
-		FileSizeDataCache.Add(PackageName, FAssetSizeData {
-			PackageName,
-			true,
-			0,
-			0,
-			false
-		});
-
-		sizeDataJustCreated = true;
-	}
-
-	FAssetSizeData& sizeData = FileSizeDataCache[PackageName];
+	SIZE_T TotalSize = 0;
+	bool bHasKnownSize = false;
+	return BuildSizeTree({ FAssetIdentifier(PackageName) }, FPrimaryAssetId(), SizeTypeToCalculate, TotalSize, bHasKnownSize);
+}
 
-	if (!sizeData.IsDirty)
-	{
-		return sizeData;
-	}
-	
+TSharedPtr<FTreeMapNodeData> UBPSizeChecker::BuildSizeTree(
+	const TArray<FAssetIdentifier>& Roots,
+	const FPrimaryAssetId& FilterPrimaryAsset,
+	const FName& SizeTypeToCalculate,
+	SIZE_T& OutTotalSize,
+	bool& OutHasKnownSize)
+{
 	TSharedPtr<FTreeMapNodeData> RootTreeMapNode = MakeShareable<FTreeMapNodeData>(new FTreeMapNodeData());
-	RootAssetIdentifiers.Empty();
-	NodeSizeMapDataMap.Empty();
 
-	RootAssetIdentifiers.Add(PackageName);
-
-	SizeType = SizeTypeToCalculate;
+	// Everything the walk needs lives on the stack of this call, so several trees can be built independently
+	FSizeTreeBuild Build;
+	Build.RootAssetIdentifiers = Roots;
+	Build.SizeType = SizeTypeToCalculate;
 
 	// First, do a pass to gather asset dependencies and build up a tree
-	TMap<FAssetIdentifier, TSharedPtr<FTreeMapNodeData>> VisitedAssetIdentifiers;
+	TMap<FAssetIdentifier, FVisitedTreeMapNode> VisitedAssetIdentifiers;
 	TSharedPtr<FTreeMapNodeData> SharedRootNode;
 	int32 NumAssetsWhichFailedToLoad = 0;
-	GatherDependenciesRecursively(VisitedAssetIdentifiers, RootAssetIdentifiers, FPrimaryAssetId(), RootTreeMapNode, SharedRootNode, NumAssetsWhichFailedToLoad);
+	if (CurrentRegistrySource->HasRegistry())
+	{
+		GatherDependencies(Build, VisitedAssetIdentifiers, FilterPrimaryAsset, RootTreeMapNode, SharedRootNode, NumAssetsWhichFailedToLoad,
+			[this, &Build](const FAssetIdentifier& AssetIdentifier, const FPrimaryAssetId& FrameFilterPrimaryAsset, FNodeSizeMapData& NodeSizeMapData,
+				TArray<FAssetIdentifier, TMemStackAllocator<>>& ReferencedAssetIdentifiers, FPrimaryAssetId& ChildFilterPrimaryAsset)
+			{
+				ResolveGatherNode(Build, AssetIdentifier, FrameFilterPrimaryAsset, NodeSizeMapData, ReferencedAssetIdentifiers, ChildFilterPrimaryAsset);
+			});
+	}
 
 	// Next, do another pass over our tree to and count how big the assets are and to set the node labels.  Also in this pass, we may
 	// create some additional "self" nodes for assets that have children but also take up size themselves.
 	int32 TotalAssetCount = 0;
 	SIZE_T TotalSize = 0;
 	bool bAnyUnknownSizes = false;
-	FinalizeNodesRecursively(RootTreeMapNode, SharedRootNode, TotalAssetCount, TotalSize, bAnyUnknownSizes);
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::FinalizeNodes);
+		SCOPE_CYCLE_COUNTER(STAT_BPSizeFinalize);
+		FinalizeNodesRecursively(Build, RootTreeMapNode, SharedRootNode, TotalAssetCount, TotalSize, bAnyUnknownSizes);
+	}
 
-	sizeData.IsDirty = false;
-	sizeData.Size = static_cast<int64>(TotalSize);
-	sizeData.HasKnownSize = !bAnyUnknownSizes;
+	OutTotalSize = TotalSize;
+	OutHasKnownSize = !bAnyUnknownSizes;
+
+	return RootTreeMapNode;
+}
 
-	if (sizeDataJustCreated)
+TSharedPtr<FBPSizeLazyTree> UBPSizeChecker::BuildLazySizeTree(const FName& PackageName, const FName& SizeTypeToCalculate)
+{
+	if (!CurrentRegistrySource->HasRegistry())
 	{
-		sizeData.InitialSize = sizeData.Size;
+		return nullptr;
 	}
 
-	return sizeData;
+	// Resolves whatever the closure still misses, the tree itself then only reads the snapshot
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+	FBPSizeClosureResult closure;
+	SizeGraph->CalculateClosureSize(PackageName, closure);
 
-	//
+	const int32 rootIndex = SizeGraph->FindOrAddPackage(PackageName);
+	if (rootIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	return MakeShared<FBPSizeLazyTree>(SizeGraph->GetSnapshot(), SizeGraph->GetPackageNames(), rootIndex, sizeTypeIndex);
 }
 
-void UBPSizeChecker::FormatAssetSize(const FAssetSizeData& SizeData, FString& OutDisplayString)
+TSharedRef<FTreeMapNodeData> UBPSizeChecker::MakeLazySizeTreeNode(const FBPSizeLazyTree& Tree, int32 NodeId)
 {
-	OutDisplayString = MakeBestSizeString(SizeData.Size, SizeData.HasKnownSize);
+	TSharedRef<FTreeMapNodeData> node = MakeShared<FTreeMapNodeData>();
 
-	if (SizeData.Size != SizeData.InitialSize)
+	const FBPSizeLazyTree::FNode& treeNode = Tree.GetNode(NodeId);
+	const FName& packageName = Tree.GetPackageName(NodeId);
+	node->LogicalName = packageName.ToString();
+
+	// Only the labels need the registry, so it's only asked about the nodes somebody looks at
+	const FAssetData assetData = CurrentRegistrySource->GetAssetByObjectPath(FBPSizePackageClassifier::MakeMainAssetPath(packageName));
+	const FString assetName = assetData.IsValid() ? assetData.AssetName.ToString() : packageName.ToString();
+	const FString assetClassPath = assetData.IsValid() ? assetData.AssetClassPath.ToString() : FString();
+
+	if (treeNode.NumChildren == 0)
 	{
-		int64 sizeDiff = SizeData.Size - SizeData.InitialSize;
-		
-		FString tmp = MakeBestSizeString(abs(sizeDiff), true);
-		OutDisplayString += FString::Format(TEXT(" ({0}{1})"), {sizeDiff >= 0 ? TEXT("+") : TEXT("-"), tmp});
+		// The STreeMap widget is not expecting zero-sized leaf nodes.  So we make them very small instead.
+		node->Size = FMath::Max<int64>(treeNode.TotalSize, 1);
+		node->CenterText = MakeBestSizeString(treeNode.TotalSize, treeNode.HasKnownSize);
+		node->Name = assetName;
+		node->Name2 = assetClassPath;
+	}
+	else
+	{
+		// Container nodes are always auto-sized
+		node->Size = 0.0f;
+		node->Name = FString::Printf(TEXT("%s  (%s, %s)"), *assetName, *assetClassPath, *MakeBestSizeString(treeNode.TotalSize, treeNode.HasKnownSize));
 	}
+
+	return node;
 }
 
-void UBPSizeChecker::GetAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate, FString& OutSize)
+void UBPSizeChecker::ExpandLazySizeTreeNode(FBPSizeLazyTree& Tree, int32 NodeId, const TSharedRef<FTreeMapNodeData>& Node, TArray<int32>& OutChildNodeIds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::ExpandLazyTreeNode);
+
+	Node->Children.Reset();
+	OutChildNodeIds.Reset();
+
+	const TConstArrayView<int32> children = Tree.GetSortedChildren(NodeId);
+	if (children.IsEmpty())
+	{
+		return;
+	}
+
+	Node->Children.Reserve(children.Num() + 1);
+	OutChildNodeIds.Reserve(children.Num() + 1);
+
+	const int64 selfSize = Tree.GetSelfSize(NodeId);
+	if (selfSize > 0)
+	{
+		// We have children, so make some space for our own asset's size within our box
+		TSharedRef<FTreeMapNodeData> selfNode = MakeShared<FTreeMapNodeData>();
+		selfNode->Parent = &Node.Get();
+		// Container nodes carry the class in their name only, so it's looked up again like the eager tree has it
+		const FAssetData assetData = CurrentRegistrySource->GetAssetByObjectPath(FBPSizePackageClassifier::MakeMainAssetPath(Tree.GetPackageName(NodeId)));
+		selfNode->Name = TEXT("*SELF*");
+		selfNode->Name2 = assetData.IsValid() ? assetData.AssetClassPath.ToString() : FString();
+		selfNode->CenterText = MakeBestSizeString(selfSize, Tree.HasKnownSelfSize(NodeId));
+		selfNode->Size = selfSize;
+
+		Node->Children.Add(selfNode);
+		OutChildNodeIds.Add(INDEX_NONE);
+	}
+
+	for (const int32 childNodeId : children)
+	{
+		TSharedRef<FTreeMapNodeData> childNode = MakeLazySizeTreeNode(Tree, childNodeId);
+		childNode->Parent = &Node.Get();
+
+		Node->Children.Add(childNode);
+		OutChildNodeIds.Add(childNodeId);
+	}
+}
+
+void UBPSizeChecker::GetPrimaryAssetSize(const FPrimaryAssetId& PrimaryAssetId, const FName& SizeTypeToCalculate, FString& OutSize)
 {
-	const FAssetSizeData& sizeData = CalculateAssetSize(PackageName, SizeTypeToCalculate);
-	FormatAssetSize(sizeData, OutSize);
+	SIZE_T totalSize = 0;
+	bool hasKnownSize = false;
+	BuildSizeTree({ FAssetIdentifier(PrimaryAssetId) }, PrimaryAssetId, SizeTypeToCalculate, totalSize, hasKnownSize);
+
+	OutSize = MakeBestSizeString(totalSize, hasKnownSize);
 }
 
-void UBPSizeChecker::Init()
+void UBPSizeChecker::GetPrimaryAssetBundleSize(const FPrimaryAssetId& PrimaryAssetId, const FName& BundleName, const FName& SizeTypeToCalculate, FString& OutSize)
 {
-	if (!EditorModule)
+	OutSize = MakeBestSizeString(0, false);
+
+	if (!UAssetManager::IsInitialized())
 	{
-		EditorModule = &IAssetManagerEditorModule::Get();
+		return;
 	}
 
-	if (!CurrentRegistrySource)
+	TSet<FSoftObjectPath> bundleAssets;
+	if (!UAssetManager::Get().GetPrimaryAssetLoadSet(bundleAssets, PrimaryAssetId, { BundleName }, false))
 	{
-		CurrentRegistrySource = EditorModule->GetCurrentRegistrySource(true);
+		return;
 	}
-	
-	IAssetRegistry* assetRegistry = IAssetRegistry::Get();
-	
-	assetRegistry->OnAssetUpdatedOnDisk().AddLambda([this](const FAssetData& assetData)
+
+	TArray<FAssetIdentifier> roots;
+	for (const FSoftObjectPath& bundleAsset : bundleAssets)
 	{
-		const FName& packageName = assetData.PackageName;
-		if (!FileSizeDataCache.Contains(packageName))
-		{
-			return;
-		}
+		roots.AddUnique(FAssetIdentifier(bundleAsset.GetLongPackageFName()));
+	}
 
-		FAssetSizeData& cachedValue = FileSizeDataCache[packageName];
-		cachedValue.IsDirty = true;
-	});
+	SIZE_T totalSize = 0;
+	bool hasKnownSize = false;
+	BuildSizeTree(roots, PrimaryAssetId, SizeTypeToCalculate, totalSize, hasKnownSize);
+
+	OutSize = MakeBestSizeString(totalSize, hasKnownSize);
 }
 
-UBlueprint* UBPSizeChecker::TryExtractBlueprintFromContext(const FToolMenuContext& ToolMenuContext)
+void UBPSizeChecker::FinishCalculation(const FBPSizeRequestBroker::FRequest& Request, const FBPSizeClosureResult& Result)
 {
-	UObject* obj = ToolMenuContext.FindByClass(UBlueprintEditorToolMenuContext::StaticClass());
-	if (!obj)
+	const TArray<FName>& sizeTypes = SizeGraph->GetSizeTypes();
+
+	FBPSizeResult& sizeData = ResultCache.FindOrAdd(Request.PackageName);
+	RecordClosure(sizeData, Result, Request.Generation, sizeTypes.Find(Request.SizeType));
+
+	sizeData.IsDirty = false;
+	sizeData.HasBeenCalculated = true;
+	sizeData.Sizes = Result.Sizes;
+	sizeData.HasKnownSizes = Result.HasKnownSizes;
+	sizeData.ModeClosures = Result.ModeClosures;
+
+	// The difference is shown against the first size ever calculated, not just the first one this session.
+	// The baseline goes to the disk cache right away, the entry may get evicted before the cache is saved.
+	// Size types added since the last calculation get theirs now.
+	DiskCache.SetContext(CurrentRegistrySource->SourceName, sizeTypes);
+	for (int32 sizeTypeIndex = sizeData.InitialSizes.Num(); sizeTypeIndex < sizeData.Sizes.Num(); ++sizeTypeIndex)
 	{
-		return nullptr;
+		const int64* baselineSize = DiskCache.FindBaseline(Request.PackageName, sizeTypes[sizeTypeIndex]);
+		sizeData.InitialSizes.Add(baselineSize ? *baselineSize : sizeData.Sizes[sizeTypeIndex]);
+		DiskCache.AddBaseline(Request.PackageName, sizeTypes[sizeTypeIndex], sizeData.InitialSizes[sizeTypeIndex]);
 	}
-	UBlueprintEditorToolMenuContext* ctx = Cast<UBlueprintEditorToolMenuContext>(obj);
 
-	if (!ctx)
+	ResultCache.Commit(Request.PackageName);
+
+	FBPSizeStats::FCalculation finishedCalculation;
+	finishedCalculation.PackageName = Request.PackageName;
+	finishedCalculation.SizeType = Request.SizeType;
+	finishedCalculation.Seconds = FPlatformTime::Seconds() - Request.StartTime;
+	finishedCalculation.NumPackages = Result.NumPackages;
+	finishedCalculation.NumRounds = Request.NumRounds;
+	finishedCalculation.FinishTime = FDateTime::Now();
+	FBPSizeStats::AddCalculation(MoveTemp(finishedCalculation));
+
+	FString formattedSize;
+	FormatAssetSize(sizeData, sizeTypes.Find(Request.SizeType), formattedSize);
+
+	TArray<FOnAssetSizeCalculated> callbacks;
+	SizeCallbacks.RemoveAndCopyValue(Request.PackageName, callbacks);
+	for (const FOnAssetSizeCalculated& callback : callbacks)
 	{
-		return nullptr;
+		callback.ExecuteIfBound(Request.PackageName, formattedSize);
 	}
+}
 
-	UBlueprint* bp = ctx->GetBlueprintObj();
+void UBPSizeChecker::RecordClosure(FBPSizeResult& SizeData, const FBPSizeClosureResult& Result, int32 Generation, int32 SizeTypeIndex)
+{
+	if (Result.ClosureWords.IsEmpty() || SizeTypeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Indices of another generation mean nothing, there's nothing to compare against then
+	FBPSizeClosureChange change;
+	if (SizeData.ClosureGeneration == Generation && !SizeData.ClosureWords.IsEmpty())
+	{
+		SizeGraph->AttributeClosureChange(SizeData.ClosureWords, Result.ClosureWords, SizeTypeIndex, change);
+	}
+
+	if (change.NumAddedPackages > 0 || !change.RemovedPackages.IsEmpty())
+	{
+		SizeData.Change = MoveTemp(change);
+	}
+	else if (SizeData.ClosureGeneration != Generation || SizeData.Sizes != Result.Sizes)
+	{
+		// Only self sizes changed, the packages of an earlier change no longer explain the number
+		SizeData.Change.Reset();
+	}
+
+	SizeData.ClosureGeneration = Generation;
+	SizeData.ClosureWords = Result.ClosureWords;
+}
+
+void UBPSizeChecker::FlushInvalidations(double EndTime)
+{
+	if (InvalidatingPackages.IsEmpty())
+	{
+		// Saves come in bursts, wait for the burst to end so every package and closure is only looked at once
+		if (DirtyPackages.IsEmpty() || FPlatformTime::Seconds() - LastInvalidationTime < CVarInvalidationDelay.GetValueOnGameThread())
+		{
+			return;
+		}
+
+		InvalidatingPackages = DirtyPackages.Array();
+		DirtyPackages.Reset();
+	}
+
+	while (!InvalidatingPackages.IsEmpty())
+	{
+		if (IsOverBudget(EndTime))
+		{
+			return;
+		}
+
+		// Every cached closure containing the saved package is stale now, not only the package's own entry.
+		// A package the graph hasn't seen yet is only stale itself.
+		const FName packageName = InvalidatingPackages.Pop(false);
+		ManagerIndex->InvalidatePackage(packageName);
+
+		// Saved, the registry has the compiled references now
+		CompileEstimates.Remove(packageName);
+
+		// Only looked up, a package the graph has never seen doesn't get added for nothing
+		TArray<FName> affectedPackages;
+		SizeGraph->InvalidatePackage(packageName, affectedPackages);
+		AffectedPackages.Append(affectedPackages);
+	}
+
+	// Only the referencers of the packages whose dependencies changed get patched
+	if (IsReferencerIndexUsed)
+	{
+		ReferencerIndex.Update(*SizeGraph);
+	}
+
+	for (const FName& affectedPackage : AffectedPackages)
+	{
+		if (FBPSizeResult* cachedValue = ResultCache.Peek(affectedPackage))
+		{
+			cachedValue->IsDirty = true;
+		}
+
+		if (const FBPSizeRequestBroker::FRequest* pendingRequest = RequestBroker->Find(affectedPackage))
+		{
+			// A calculation in flight may have already walked past one of the saved packages
+			const FName pendingSizeType = pendingRequest->SizeType;
+			const uint8 pendingModes = pendingRequest->Modes;
+			RequestBroker->Restart(affectedPackage, pendingSizeType, pendingModes);
+		}
+	}
+	AffectedPackages.Reset();
+}
+
+bool UBPSizeChecker::TickCalculations(float DeltaTime)
+{
+	// The walks run on background tasks, what's left for the game thread shares one budget per frame and resumes next tick
+	const float budgetMs = CVarTickBudgetMs.GetValueOnGameThread();
+	const double endTime = budgetMs > 0.0f ? FPlatformTime::Seconds() + budgetMs / 1000.0 : 0.0;
+
+	FlushInvalidations(endTime);
+
+	RequestBroker->Tick(endTime, GetNumClosureThreads());
+
+	return true;
+}
+
+void UBPSizeChecker::OnAssetClosedInEditor(UObject* Asset, IAssetEditorInstance* AssetEditorInstance)
+{
+	if (Asset)
+	{
+		CancelAssetSizeRequest(Asset->GetPackage()->GetFName());
+	}
+
+	if (UBlueprint* blueprint = Cast<UBlueprint>(Asset))
+	{
+		UntrackBlueprintCompiles(blueprint);
+	}
+}
+
+void UBPSizeChecker::TrackBlueprintCompiles(UBlueprint* Blueprint)
+{
+	if (!CompiledHandles.Contains(Blueprint))
+	{
+		CompiledHandles.Add(Blueprint, Blueprint->OnCompiled().AddUObject(this, &UBPSizeChecker::OnBlueprintCompiled));
+	}
+}
+
+void UBPSizeChecker::UntrackBlueprintCompiles(UBlueprint* Blueprint)
+{
+	FDelegateHandle compiledHandle;
+	if (CompiledHandles.RemoveAndCopyValue(Blueprint, compiledHandle))
+	{
+		Blueprint->OnCompiled().Remove(compiledHandle);
+	}
+}
+
+void UBPSizeChecker::OnBlueprintCompiled(UBlueprint* Blueprint)
+{
+	// Estimated in every size type at once, whichever the toolbar shows
+	if (SizeGraph)
+	{
+		UpdateCompileEstimate(Blueprint);
+	}
+}
+
+bool UBPSizeChecker::UpdateCompileEstimate(UBlueprint* Blueprint)
+{
+	if (!Blueprint || !CurrentRegistrySource->HasRegistry())
+	{
+		return false;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::UpdateCompileEstimate);
+
+	TArray<FName> inMemoryDependencies;
+	GatherInMemoryDependencies(Blueprint, inMemoryDependencies);
+
+	const FName packageName = Blueprint->GetPackage()->GetFName();
+	FBPSizeClosureEstimate& estimate = CompileEstimates.FindOrAdd(packageName);
+	SizeGraph->EstimateClosureSize(packageName, inMemoryDependencies, estimate);
+
+	return true;
+}
+
+void UBPSizeChecker::GatherInMemoryDependencies(UBlueprint* Blueprint, TArray<FName>& OutPackageNames)
+{
+	UPackage* package = Blueprint->GetPackage();
+	UClass* generatedClass = Blueprint->GeneratedClass;
+	if (!generatedClass)
+	{
+		return;
+	}
+
+	// Only the generated class, its default object and their subobjects make it into the game, the saved
+	// hard game edges they get compared against don't know about the graphs and the other editor-only data.
+	// The skeleton class and whatever else is transient isn't saved at all.
+	TArray<UObject*> gameObjects;
+	gameObjects.Add(generatedClass);
+	GetObjectsWithOuter(generatedClass, gameObjects, true, RF_Transient);
+	if (UObject* defaultObject = generatedClass->GetDefaultObject(false))
+	{
+		gameObjects.Add(defaultObject);
+		GetObjectsWithOuter(defaultObject, gameObjects, true, RF_Transient);
+	}
+
+	TArray<UObject*> referencedObjects;
+	FGameReferenceCollector referenceCollector(referencedObjects);
+	for (UObject* gameObject : gameObjects)
+	{
+		if (!gameObject->IsEditorOnly())
+		{
+			gameObject->Serialize(referenceCollector);
+		}
+	}
+
+	for (const UObject* referencedObject : referencedObjects)
+	{
+		const UPackage* referencedPackage = referencedObject->GetPackage();
+		if (referencedPackage != package && referencedPackage != GetTransientPackage() && !referencedPackage->HasAnyFlags(RF_Transient))
+		{
+			OutPackageNames.AddUnique(referencedPackage->GetFName());
+		}
+	}
+}
+
+void UBPSizeChecker::AppendCompileEstimate(const FName& PackageName, const FBPSizeResult& SizeData, int32 SizeTypeIndex, FString& OutDisplayString) const
+{
+	// Estimates made before the size type was added don't have it
+	const FBPSizeClosureEstimate* estimate = CompileEstimates.Find(PackageName);
+	if (!estimate || !estimate->EstimatedSizes.IsValidIndex(SizeTypeIndex) || estimate->EstimatedSizes[SizeTypeIndex] == estimate->SavedSizes[SizeTypeIndex])
+	{
+		return;
+	}
+
+	// Applied as a difference, the saved closure may have changed through other saves since the compile
+	const int64 estimatedSize = FMath::Max<int64>(SizeData.Sizes[SizeTypeIndex] + estimate->EstimatedSizes[SizeTypeIndex] - estimate->SavedSizes[SizeTypeIndex], 0);
+	const bool hasKnownSize = SizeData.HasKnownSizes[SizeTypeIndex] && estimate->HasKnownSizes[SizeTypeIndex];
+	OutDisplayString += FString::Format(TEXT(", ~{0} after compile"), {MakeBestSizeString(estimatedSize, hasKnownSize)});
+}
+
+void UBPSizeChecker::FormatAssetSize(const FBPSizeResult& SizeData, int32 SizeTypeIndex, FString& OutDisplayString)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::FormatAssetSize);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeFormat);
+
+	if (!SizeData.HasSize(SizeTypeIndex))
+	{
+		OutDisplayString = MakeBestSizeString(0, false);
+		return;
+	}
+
+	const int64 size = SizeData.Sizes[SizeTypeIndex];
+	const int64 initialSize = SizeData.InitialSizes[SizeTypeIndex];
+	OutDisplayString = MakeBestSizeString(size, SizeData.HasKnownSizes[SizeTypeIndex]);
+
+	if (size != initialSize)
+	{
+		int64 sizeDiff = size - initialSize;
+		
+		FString tmp = MakeBestSizeString(abs(sizeDiff), true);
+		OutDisplayString += FString::Format(TEXT(" ({0}{1})"), {sizeDiff >= 0 ? TEXT("+") : TEXT("-"), tmp});
+	}
+}
+
+void UBPSizeChecker::GetFormattedAssetSize(const FName& PackageName, TConstArrayView<int32> SizeTypeIndices, const FName& SizeTypeToCalculate, FString& OutSize)
+{
+	const FBPSizeResult* sizeData = ResultCache.Find(PackageName);
+	const bool hasAllSizes = sizeData && Algo::AllOf(SizeTypeIndices, [sizeData](int32 SizeTypeIndex) { return sizeData->HasSize(SizeTypeIndex); });
+
+	auto formatSizes = [this, &PackageName, SizeTypeIndices, sizeData](FString& OutFormattedSizes)
+	{
+		for (const int32 sizeTypeIndex : SizeTypeIndices)
+		{
+			FString formattedSize;
+			FormatAssetSize(*sizeData, sizeTypeIndex, formattedSize);
+			AppendCompileEstimate(PackageName, *sizeData, sizeTypeIndex, formattedSize);
+
+			if (!OutFormattedSizes.IsEmpty())
+			{
+				OutFormattedSizes += TEXT(" / ");
+			}
+			OutFormattedSizes += formattedSize;
+		}
+	};
+
+	OutSize.Reset();
+	if (hasAllSizes && !sizeData->IsDirty)
+	{
+		formatSizes(OutSize);
+		return;
+	}
+
+	// Every toolbar showing the package joins the same request
+	const FBPSizeRequestBroker::FRequest& request = RequestBroker->Request(PackageName, SizeTypeToCalculate, GetCalculationModes());
+
+	FString progress = request.NumResolvedPackages > 0
+		? FString::Format(TEXT("calculating... {0} packages"), {request.NumResolvedPackages})
+		: FString(TEXT("calculating..."));
+
+	if (hasAllSizes)
+	{
+		// Keep showing the last known numbers, so the toolbar doesn't flicker after every save
+		formatSizes(OutSize);
+		OutSize += FString::Format(TEXT(" ({0})"), {progress});
+	}
+	else
+	{
+		OutSize = MoveTemp(progress);
+	}
+}
+
+void UBPSizeChecker::GetAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate, FString& OutSize)
+{
+	// A size type the graph doesn't collect yet resets it, the results of the other size types stay valid
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+	GetFormattedAssetSize(PackageName, MakeArrayView(&sizeTypeIndex, 1), SizeTypeToCalculate, OutSize);
+}
+
+void UBPSizeChecker::GetAssetMemoryAndDiskSize(const FName& PackageName, FString& OutSize)
+{
+	const int32 sizeTypeIndices[] =
+	{
+		SizeGraph->FindOrAddSizeType(IAssetManagerEditorModule::ResourceSizeName),
+		SizeGraph->FindOrAddSizeType(IAssetManagerEditorModule::DiskSizeName)
+	};
+	GetFormattedAssetSize(PackageName, sizeTypeIndices, IAssetManagerEditorModule::ResourceSizeName, OutSize);
+}
+
+void UBPSizeChecker::GetAssetSoftReferencePotential(const FName& PackageName, const FName& SizeTypeToCalculate, FString& OutSize)
+{
+	OutSize.Reset();
+
+	const int32 sizeTypeIndex = SizeGraph->FindSizeType(SizeTypeToCalculate);
+	const FBPSizeResult* sizeData = ResultCache.Peek(PackageName);
+	if (!sizeData || !sizeData->HasSize(sizeTypeIndex) || sizeData->ModeClosures.IsEmpty() || sizeData->IsDirty)
+	{
+		// The toolbar calculations only walk hard game references, this one walks every mode
+		RequestBroker->Request(PackageName, SizeTypeToCalculate, BPSizeDependencyModes::All);
+	}
+
+	if (!sizeData || !sizeData->HasSize(sizeTypeIndex) || sizeData->ModeClosures.IsEmpty())
+	{
+		return;
+	}
+
+	const FBPSizeModeClosure& hardEditor = sizeData->ModeClosures[static_cast<int32>(EBPSizeDependencyMode::HardEditor)];
+	const FBPSizeModeClosure& softGame = sizeData->ModeClosures[static_cast<int32>(EBPSizeDependencyMode::SoftGame)];
+	const int64 softPotential = softGame.Sizes[sizeTypeIndex] - sizeData->Sizes[sizeTypeIndex];
+
+	OutSize = FString::Format(TEXT("{0} in the editor, up to {1} with soft references (+{2})"),
+	{
+		MakeBestSizeString(hardEditor.Sizes[sizeTypeIndex], hardEditor.HasKnownSizes[sizeTypeIndex]),
+		MakeBestSizeString(softGame.Sizes[sizeTypeIndex], softGame.HasKnownSizes[sizeTypeIndex]),
+		MakeBestSizeString(FMath::Max<int64>(softPotential, 0), true)
+	});
+}
+
+void UBPSizeChecker::GetAssetSizeChange(const FName& PackageName, TArray<FBPAssetSizeChangeEdge>& OutAddedEdges, int64& OutAddedSize, int64& OutRemovedSize)
+{
+	OutAddedEdges.Reset();
+	OutAddedSize = 0;
+	OutRemovedSize = 0;
+
+	const FBPSizeResult* sizeData = ResultCache.Peek(PackageName);
+	if (!sizeData || !sizeData->Change.IsSet())
+	{
+		return;
+	}
+
+	const FBPSizeClosureChange* change = &sizeData->Change.GetValue();
+
+	OutAddedSize = change->AddedSize;
+	OutRemovedSize = change->RemovedSize;
+
+	OutAddedEdges.Reserve(change->AddedEdges.Num());
+	for (const FBPSizeEdgeContribution& addedEdge : change->AddedEdges)
+	{
+		FBPAssetSizeChangeEdge& edge = OutAddedEdges.AddDefaulted_GetRef();
+		edge.ReferencerName = addedEdge.ReferencerName;
+		edge.DependencyName = addedEdge.DependencyName;
+		edge.Size = addedEdge.Size;
+		edge.NumPackages = addedEdge.NumPackages;
+	}
+}
+
+void UBPSizeChecker::GetAssetSizeChangeTooltip(const FName& PackageName, FString& OutTooltip)
+{
+	OutTooltip.Reset();
+
+	const FBPSizeResult* sizeData = ResultCache.Peek(PackageName);
+	if (!sizeData || !sizeData->Change.IsSet())
+	{
+		return;
+	}
+
+	const FBPSizeClosureChange* change = &sizeData->Change.GetValue();
+
+	// Long lists don't fit a tooltip, the biggest entries are the interesting ones anyway
+	constexpr int32 MaxTooltipLines = 8;
+
+	if (change->NumAddedPackages > 0)
+	{
+		OutTooltip += FString::Printf(TEXT("+%s from %d new packages:\n"), *MakeBestSizeString(change->AddedSize, true), change->NumAddedPackages);
+		for (int32 edgeOrdinal = 0; edgeOrdinal < change->AddedEdges.Num() && edgeOrdinal < MaxTooltipLines; ++edgeOrdinal)
+		{
+			const FBPSizeEdgeContribution& edge = change->AddedEdges[edgeOrdinal];
+			OutTooltip += FString::Printf(TEXT("    %s -> %s: %s (%d packages)\n"),
+				*edge.ReferencerName.ToString(),
+				*edge.DependencyName.ToString(),
+				*MakeBestSizeString(edge.Size, true),
+				edge.NumPackages);
+		}
+	}
+
+	if (!change->RemovedPackages.IsEmpty())
+	{
+		OutTooltip += FString::Printf(TEXT("-%s from %d packages no longer referenced:\n"), *MakeBestSizeString(change->RemovedSize, true), change->RemovedPackages.Num());
+		for (int32 packageOrdinal = 0; packageOrdinal < change->RemovedPackages.Num() && packageOrdinal < MaxTooltipLines; ++packageOrdinal)
+		{
+			const FBPSizePackageSize& removedPackage = change->RemovedPackages[packageOrdinal];
+			OutTooltip += FString::Printf(TEXT("    %s: %s\n"), *removedPackage.PackageName.ToString(), *MakeBestSizeString(removedPackage.Size, true));
+		}
+	}
+
+	OutTooltip.TrimEndInline();
+}
+
+void UBPSizeChecker::RequestAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate, const FOnAssetSizeCalculated& OnCalculated)
+{
+	// Whoever was waiting for the outdated calculation still gets an answer, from the new one
+	RequestBroker->Restart(PackageName, SizeTypeToCalculate, GetCalculationModes());
+	SizeCallbacks.FindOrAdd(PackageName).Add(OnCalculated);
+}
+
+void UBPSizeChecker::EstimateBlueprintSize(UBlueprint* Blueprint, const FName& SizeTypeToCalculate, FString& OutSize)
+{
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+	if (!UpdateCompileEstimate(Blueprint))
+	{
+		OutSize = MakeBestSizeString(0, false);
+		return;
+	}
+
+	const FBPSizeClosureEstimate& estimate = CompileEstimates.FindChecked(Blueprint->GetPackage()->GetFName());
+	OutSize = MakeBestSizeString(estimate.EstimatedSizes[sizeTypeIndex], estimate.HasKnownSizes[sizeTypeIndex]);
+}
+
+void UBPSizeChecker::CancelAssetSizeRequest(const FName& PackageName)
+{
+	RequestBroker->Cancel(PackageName);
+	SizeCallbacks.Remove(PackageName);
+}
+
+void UBPSizeChecker::Init()
+{
+	if (!EditorModule)
+	{
+		EditorModule = &IAssetManagerEditorModule::Get();
+	}
+
+	if (!CurrentRegistrySource)
+	{
+		CurrentRegistrySource = EditorModule->GetCurrentRegistrySource(true);
+	}
+
+	if (!IsDiskCacheLoaded)
+	{
+		DiskCache.Load(FBPSizeDiskCache::GetDefaultFilename());
+		IsDiskCacheLoaded = true;
+	}
+
+	if (!SizeGraph)
+	{
+		SizeGraph = MakeUnique<FBPSizeGraph>(*EditorModule, *CurrentRegistrySource);
+		SizeGraph->SetDiskCache(&DiskCache);
+	}
+
+	if (!ManagerIndex)
+	{
+		ManagerIndex = MakeUnique<FBPSizeManagerIndex>(*CurrentRegistrySource);
+	}
+
+	if (!ChunkIndex)
+	{
+		ChunkIndex = MakeUnique<FBPSizeChunkIndex>(*CurrentRegistrySource);
+	}
+
+	if (!RequestBroker)
+	{
+		RequestBroker = MakeUnique<FBPSizeRequestBroker>(*SizeGraph, *CurrentRegistrySource);
+		RequestBroker->OnRequestFinished.BindUObject(this, &UBPSizeChecker::FinishCalculation);
+	}
+
+	if (!EnginePreExitHandle.IsValid())
+	{
+		// The checker may outlive the point where writing files is still safe, so don't wait for BeginDestroy
+		EnginePreExitHandle = FCoreDelegates::OnEnginePreExit.AddUObject(this, &UBPSizeChecker::SaveDiskCache);
+	}
+
+	if (!TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UBPSizeChecker::TickCalculations));
+	}
+
+	if (!AssetClosedHandle.IsValid() && GEditor)
+	{
+		AssetClosedHandle = GEditor->GetEditorSubsystem<UAssetEditorSubsystem>()->OnAssetClosedInEditor().AddUObject(this, &UBPSizeChecker::OnAssetClosedInEditor);
+	}
+	
+	if (!AssetUpdatedOnDiskHandle.IsValid())
+	{
+		// Init runs every time the toolbar is created, the checker must only be registered once
+		AssetUpdatedOnDiskHandle = IAssetRegistry::GetChecked().OnAssetUpdatedOnDisk().AddUObject(this, &UBPSizeChecker::OnAssetUpdatedOnDisk);
+		AssetAddedHandle = IAssetRegistry::GetChecked().OnAssetAdded().AddUObject(this, &UBPSizeChecker::OnAssetAdded);
+		AssetRemovedHandle = IAssetRegistry::GetChecked().OnAssetRemoved().AddUObject(this, &UBPSizeChecker::OnAssetRemoved);
+		AssetRenamedHandle = IAssetRegistry::GetChecked().OnAssetRenamed().AddUObject(this, &UBPSizeChecker::OnAssetRenamed);
+	}
+}
+
+void UBPSizeChecker::OnAssetUpdatedOnDisk(const FAssetData& AssetData)
+{
+	// Handled by the ticker once the saves stop coming
+	DirtyPackages.Add(AssetData.PackageName);
+	LastInvalidationTime = FPlatformTime::Seconds();
+
+	// A new blueprint isn't in the graph yet, the referencer index only knows what the graph has resolved
+	if (IsReferencerIndexUsed && AssetData.TagsAndValues.Contains(FBlueprintTags::GeneratedClassPath))
+	{
+		BlueprintPackages.Add(AssetData.PackageName);
+		PendingBlueprintPackages.Add(AssetData.PackageName);
+	}
+}
+
+void UBPSizeChecker::OnAssetAdded(const FAssetData& AssetData)
+{
+	// Blueprints created in the editor have no generated class tag until they are saved
+	if (IsReferencerIndexUsed && AssetData.IsInstanceOf(UBlueprint::StaticClass()))
+	{
+		BlueprintPackages.Add(AssetData.PackageName);
+		PendingBlueprintPackages.Add(AssetData.PackageName);
+	}
+}
+
+void UBPSizeChecker::OnAssetRemoved(const FAssetData& AssetData)
+{
+	// The graph keeps the package, it just isn't reported anymore
+	BlueprintPackages.Remove(AssetData.PackageName);
+	PendingBlueprintPackages.Remove(AssetData.PackageName);
+}
+
+void UBPSizeChecker::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath)
+{
+	const FName oldPackageName(FPackageName::ObjectPathToPackageName(OldObjectPath));
+	if (BlueprintPackages.Remove(oldPackageName) > 0 || (IsReferencerIndexUsed && AssetData.IsInstanceOf(UBlueprint::StaticClass())))
+	{
+		PendingBlueprintPackages.Remove(oldPackageName);
+		BlueprintPackages.Add(AssetData.PackageName);
+		PendingBlueprintPackages.Add(AssetData.PackageName);
+	}
+}
+
+void UBPSizeChecker::GetChunkSize(int32 ChunkId, const FName& SizeTypeToCalculate, FString& OutSize)
+{
+	const TArray<FName>* chunkPackages = ChunkIndex->FindChunkPackages(ChunkId);
+	if (!chunkPackages)
+	{
+		OutSize = MakeBestSizeString(0, false);
+		return;
+	}
+
+	// Everything assigned to the chunk, the graph memoizes the sizes for later closures too
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+
+	TArray<int32> packageIndices;
+	packageIndices.Reserve(chunkPackages->Num());
+	for (const FName& chunkPackage : *chunkPackages)
+	{
+		const int32 packageIndex = SizeGraph->FindOrAddPackage(chunkPackage);
+		if (packageIndex != INDEX_NONE)
+		{
+			packageIndices.Add(packageIndex);
+		}
+	}
+	SizeGraph->ResolvePackages(packageIndices);
+
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = SizeGraph->GetSnapshot();
+	int64 totalSize = 0;
+	bool hasKnownSize = true;
+	for (const int32 packageIndex : packageIndices)
+	{
+		totalSize += snapshot->SelfSizes[sizeTypeIndex][packageIndex];
+		hasKnownSize &= snapshot->KnownSizes[sizeTypeIndex][packageIndex];
+	}
+
+	OutSize = MakeBestSizeString(totalSize, hasKnownSize);
+}
+
+void UBPSizeChecker::GetAssetChunks(const FName& PackageName, TArray<int32>& OutChunkIds)
+{
+	OutChunkIds.Reset();
+
+	TArray<FName> closurePackages;
+	SizeGraph->GatherClosurePackages(PackageName, closurePackages);
+
+	for (const FName& closurePackage : closurePackages)
+	{
+		for (const int32 chunkId : ChunkIndex->GetPackageChunks(closurePackage))
+		{
+			OutChunkIds.AddUnique(chunkId);
+		}
+	}
+
+	OutChunkIds.Sort();
+}
+
+void UBPSizeChecker::GetAssetRetainedSizes(const FName& PackageName, const FName& SizeTypeToCalculate, int32 MaxEntries, TArray<FBPAssetRetainedSize>& OutEntries)
+{
+	OutEntries.Reset();
+
+	if (!CurrentRegistrySource->HasRegistry())
+	{
+		return;
+	}
+
+	// Resolves whatever the closure still misses, the dominators are then worked out on the snapshot alone
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+	FBPSizeClosureResult closure;
+	SizeGraph->CalculateClosureSize(PackageName, closure);
+
+	const int32 rootIndex = SizeGraph->FindOrAddPackage(PackageName);
+	if (rootIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FBPSizeDominatorTree dominatorTree(*SizeGraph->GetSnapshot(), rootIndex, sizeTypeIndex);
+	const TArray<FName>& packageNames = SizeGraph->GetPackageNames();
+
+	TArray<int32> nodeIds;
+	nodeIds.Reserve(dominatorTree.GetNumNodes());
+	for (int32 nodeId = FBPSizeDominatorTree::RootNode + 1; nodeId < dominatorTree.GetNumNodes(); ++nodeId)
+	{
+		nodeIds.Add(nodeId);
+	}
+	nodeIds.Sort([&dominatorTree](int32 A, int32 B) { return dominatorTree.GetNode(A).RetainedSize > dominatorTree.GetNode(B).RetainedSize; });
+	if (MaxEntries > 0 && nodeIds.Num() > MaxEntries)
+	{
+		nodeIds.SetNum(MaxEntries);
+	}
+
+	OutEntries.Reserve(nodeIds.Num());
+	for (const int32 nodeId : nodeIds)
+	{
+		const FBPSizeDominatorTree::FNode& node = dominatorTree.GetNode(nodeId);
+
+		FBPAssetRetainedSize& entry = OutEntries.AddDefaulted_GetRef();
+		entry.PackageName = packageNames[node.PackageIndex];
+		entry.DominatorName = packageNames[dominatorTree.GetNode(node.ImmediateDominator).PackageIndex];
+		entry.RetainedSize = node.RetainedSize;
+		entry.HasKnownSize = node.HasKnownSize;
+		entry.NumRetainedPackages = node.NumRetainedPackages;
+	}
+}
+
+void UBPSizeChecker::GetAssetReferencers(const FName& PackageName, const FName& SizeTypeToCalculate, TArray<FBPAssetReferencerEntry>& OutEntries)
+{
+	OutEntries.Reset();
+
+	if (!CurrentRegistrySource->HasRegistry())
+	{
+		return;
+	}
+
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+
+	if (!IsReferencerIndexUsed)
+	{
+		// Cooked registries have no blueprint assets, the editor's one knows all of them either way
+		FARFilter filter;
+		filter.ClassPaths.Add(UBlueprint::StaticClass()->GetClassPathName());
+		filter.bRecursiveClasses = true;
+
+		TArray<FAssetData> blueprintAssets;
+		IAssetRegistry::GetChecked().GetAssets(filter, blueprintAssets);
+		for (const FAssetData& blueprintAsset : blueprintAssets)
+		{
+			BlueprintPackages.Add(blueprintAsset.PackageName);
+		}
+
+		PendingBlueprintPackages.Append(BlueprintPackages);
+		IsReferencerIndexUsed = true;
+	}
+
+	if (!PendingBlueprintPackages.IsEmpty())
+	{
+		// The batch queries the registry once per package no matter how many blueprints share it
+		FBPSizeBatchResult batchResult;
+		SizeGraph->CalculateClosureSizes(PendingBlueprintPackages.Array(), batchResult);
+		PendingBlueprintPackages.Reset();
+	}
+
+	ReferencerIndex.Update(*SizeGraph);
+
+	const int32 targetIndex = SizeGraph->FindOrAddPackage(PackageName);
+	TArray<int32> referencers;
+	TArray<int32> nextHops;
+	ReferencerIndex.GatherReferencers(targetIndex, referencers, nextHops);
+
+	TMap<int32, int32> nextHopOfPackage;
+	nextHopOfPackage.Reserve(referencers.Num());
+	for (int32 referencerOrdinal = 0; referencerOrdinal < referencers.Num(); ++referencerOrdinal)
+	{
+		nextHopOfPackage.Add(referencers[referencerOrdinal], nextHops[referencerOrdinal]);
+	}
+
+	TArray<int32> blueprintIndices;
+	TArray<FName> blueprintNames;
+	for (const int32 referencerIndex : referencers)
+	{
+		const FName referencerName = SizeGraph->GetPackageNames()[referencerIndex];
+		if (BlueprintPackages.Contains(referencerName))
+		{
+			blueprintIndices.Add(referencerIndex);
+			blueprintNames.Add(referencerName);
+		}
+	}
+
+	// Saves since the index was built may have left parts of their closures unresolved, the contributions need all of them
+	FBPSizeBatchResult blueprintClosures;
+	SizeGraph->CalculateClosureSizes(blueprintNames, blueprintClosures);
+	ReferencerIndex.Update(*SizeGraph);
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = SizeGraph->GetSnapshot();
+
+	// What leaves the closure of a blueprint together with the asset is what the asset dominates in it
+	TArray<FBPSizeContribution> contributions;
+	ReferencerIndex.CalculateContributions(*snapshot, targetIndex, blueprintIndices, sizeTypeIndex, contributions);
+
+	const TArray<FName>& packageNames = SizeGraph->GetPackageNames();
+	for (int32 blueprintOrdinal = 0; blueprintOrdinal < blueprintIndices.Num(); ++blueprintOrdinal)
+	{
+		const FBPSizeContribution& contribution = contributions[blueprintOrdinal];
+		if (!contribution.ReachesTarget)
+		{
+			continue;
+		}
+
+		const int32 blueprintIndex = blueprintIndices[blueprintOrdinal];
+		FBPAssetReferencerEntry& entry = OutEntries.AddDefaulted_GetRef();
+		entry.PackageName = packageNames[blueprintIndex];
+		entry.ContributedSize = contribution.Size;
+		entry.HasKnownSize = contribution.HasKnownSize;
+
+		// The next hops lead down to the package, which is the only one without a next hop of its own
+		for (const int32* packageIndex = &blueprintIndex; packageIndex; packageIndex = nextHopOfPackage.Find(*packageIndex))
+		{
+			entry.ReferencePath.Add(packageNames[*packageIndex]);
+		}
+	}
+}
+
+void UBPSizeChecker::GetAssetSizes(const TArray<FName>& PackageNames, const FName& SizeTypeToCalculate, TArray<FBPAssetSizeEntry>& OutSizes, int64& OutOverlapSize)
+{
+	OutSizes.Reset(PackageNames.Num());
+	OutOverlapSize = 0;
+
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+	FBPSizeBatchResult batchResult;
+	if (CurrentRegistrySource->HasRegistry())
+	{
+		SizeGraph->CalculateClosureSizes(PackageNames, batchResult);
+	}
+
+	for (int32 packageOrdinal = 0; packageOrdinal < PackageNames.Num(); ++packageOrdinal)
+	{
+		FBPAssetSizeEntry& entry = OutSizes.AddDefaulted_GetRef();
+		entry.PackageName = PackageNames[packageOrdinal];
+
+		if (batchResult.Closures.IsValidIndex(packageOrdinal))
+		{
+			const FBPSizeClosureResult& closure = batchResult.Closures[packageOrdinal];
+			entry.Size = closure.Sizes[sizeTypeIndex];
+			entry.ExclusiveSize = batchResult.ExclusiveSizes[sizeTypeIndex][packageOrdinal];
+			entry.HasKnownSize = closure.HasKnownSizes[sizeTypeIndex];
+			entry.NumPackages = closure.NumPackages;
+		}
+	}
+
+	if (batchResult.OverlapSizes.IsValidIndex(sizeTypeIndex))
+	{
+		OutOverlapSize = batchResult.OverlapSizes[sizeTypeIndex];
+	}
+}
+
+bool UBPSizeChecker::LogClosureScaling(const FName& PackageName, const FName& SizeTypeToCalculate)
+{
+	if (!SizeGraph || !CurrentRegistrySource->HasRegistry())
+	{
+		return false;
+	}
+
+	// Resolve everything up front, so only the walk itself gets timed. Every size type gets summed up by every walk.
+	const int32 sizeTypeIndex = SizeGraph->FindOrAddSizeType(SizeTypeToCalculate);
+	FBPSizeClosureResult expected;
+	SizeGraph->CalculateClosureSize(PackageName, expected);
+	const int64 expectedSize = expected.Sizes[sizeTypeIndex];
+
+	const int32 rootIndex = SizeGraph->FindOrAddPackage(PackageName);
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = SizeGraph->GetSnapshot();
+
+	constexpr int32 NumRepeats = 10;
+	for (const int32 numThreads : {1, 2, 4, 8, 16})
+	{
+		FBPSizeClosureResult result;
+		const double startTime = FPlatformTime::Seconds();
+		for (int32 repeat = 0; repeat < NumRepeats; ++repeat)
+		{
+			result = snapshot->CalculateClosure(rootIndex, nullptr, numThreads);
+		}
+		const double milliseconds = (FPlatformTime::Seconds() - startTime) * 1000.0 / NumRepeats;
+
+		const bool matches = result.Sizes == expected.Sizes && result.HasKnownSizes == expected.HasKnownSizes;
+		UE_LOG(LogTemp, Display, TEXT("%s, %d thread(s): %.3f ms, %d packages, %lld bytes%s"),
+			*PackageName.ToString(), numThreads, milliseconds, result.NumPackages, result.Sizes[sizeTypeIndex], matches ? TEXT("") : TEXT(" (MISMATCH)"));
+	}
+
+	// For comparison, the condensed batch path and the SizeMap style tree the plugin used to build for every size
+	{
+		const double startTime = FPlatformTime::Seconds();
+		const FBPSizeBatchResult batchResult = snapshot->CalculateClosures(MakeArrayView(&rootIndex, 1));
+		const double milliseconds = (FPlatformTime::Seconds() - startTime) * 1000.0;
+
+		const bool matches = batchResult.Closures[0].Sizes == expected.Sizes && batchResult.Closures[0].HasKnownSizes == expected.HasKnownSizes;
+		UE_LOG(LogTemp, Display, TEXT("%s, condensed: %.3f ms%s"), *PackageName.ToString(), milliseconds, matches ? TEXT("") : TEXT(" (MISMATCH)"));
+	}
+	{
+		const double startTime = FPlatformTime::Seconds();
+		BuildAssetSizeTree(PackageName, SizeTypeToCalculate);
+		const double milliseconds = (FPlatformTime::Seconds() - startTime) * 1000.0;
+
+		UE_LOG(LogTemp, Display, TEXT("%s, size tree: %.3f ms"), *PackageName.ToString(), milliseconds);
+	}
+	const double lazyTreeStartTime = FPlatformTime::Seconds();
+	if (TSharedPtr<FBPSizeLazyTree> lazyTree = BuildLazySizeTree(PackageName, SizeTypeToCalculate))
+	{
+		const double buildMilliseconds = (FPlatformTime::Seconds() - lazyTreeStartTime) * 1000.0;
+
+		// The root usually has the most children, expanding it is the worst case of a drill-down
+		const double expandStartTime = FPlatformTime::Seconds();
+		TSharedRef<FTreeMapNodeData> rootNode = MakeLazySizeTreeNode(*lazyTree, FBPSizeLazyTree::RootNode);
+		TArray<int32> childNodeIds;
+		ExpandLazySizeTreeNode(*lazyTree, FBPSizeLazyTree::RootNode, rootNode, childNodeIds);
+		const double expandMilliseconds = (FPlatformTime::Seconds() - expandStartTime) * 1000.0;
+
+		const bool matches = lazyTree->GetNode(FBPSizeLazyTree::RootNode).TotalSize == expectedSize;
+		UE_LOG(LogTemp, Display, TEXT("%s, lazy tree: %.3f ms, expanding the root into %d nodes: %.3f ms%s"),
+			*PackageName.ToString(), buildMilliseconds, childNodeIds.Num(), expandMilliseconds, matches ? TEXT("") : TEXT(" (MISMATCH)"));
+	}
+	{
+		const double startTime = FPlatformTime::Seconds();
+		const FBPSizeDominatorTree dominatorTree(*snapshot, rootIndex, sizeTypeIndex);
+		const double milliseconds = (FPlatformTime::Seconds() - startTime) * 1000.0;
+
+		const bool matches = dominatorTree.GetNumNodes() > 0 && dominatorTree.GetNode(FBPSizeDominatorTree::RootNode).RetainedSize == expectedSize;
+		UE_LOG(LogTemp, Display, TEXT("%s, dominator tree: %.3f ms, %d passes%s"),
+			*PackageName.ToString(), milliseconds, dominatorTree.GetNumPasses(), matches ? TEXT("") : TEXT(" (MISMATCH)"));
+	}
+
+	return true;
+}
+
+bool UBPSizeChecker::LogResultCacheStats(bool ResetCounters)
+{
+	if (!SizeGraph)
+	{
+		return false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Results: %d packages in %llu KB (peak %llu KB), %llu hits, %llu misses, %llu evicted"),
+		ResultCache.GetNumEntries(),
+		static_cast<uint64>(ResultCache.GetNumBytes() / 1024),
+		static_cast<uint64>(ResultCache.GetPeakBytes() / 1024),
+		ResultCache.GetNumHits(),
+		ResultCache.GetNumMisses(),
+		ResultCache.GetNumEvictions());
+
+	if (ResetCounters)
+	{
+		ResultCache.ResetCounters();
+	}
+
+	return true;
+}
+
+bool UBPSizeChecker::LogSizeProviderStats(bool ResetCounters)
+{
+	if (!SizeGraph)
+	{
+		return false;
+	}
+
+	FBPSizeProvider& sizeProvider = SizeGraph->GetSizeProvider();
+	UE_LOG(LogTemp, Display, TEXT("Self sizes: %llu hits, %llu misses, %llu prefetched, %d packages cached"),
+		sizeProvider.GetNumHits(), sizeProvider.GetNumMisses(), sizeProvider.GetNumPrefetched(), sizeProvider.GetNumCachedPackages());
+
+	if (ResetCounters)
+	{
+		sizeProvider.ResetCounters();
+	}
+
+	return true;
+}
+
+void UBPSizeChecker::SaveDiskCache()
+{
+	if (!SizeGraph)
+	{
+		return;
+	}
+
+	// The baselines are already in there, they get added when a package is first calculated
+	SizeGraph->ExportToDiskCache(DiskCache);
+
+	// Packages deleted since they were cached have no package data anymore. While the registry is still scanning
+	// that's true of packages which do exist too.
+	IAssetRegistry& assetRegistry = IAssetRegistry::GetChecked();
+	if (!assetRegistry.IsLoadingAssets())
+	{
+		DiskCache.RemovePackages([&assetRegistry](const FName& PackageName)
+		{
+			return !assetRegistry.GetAssetPackageDataCopy(PackageName).IsSet();
+		});
+	}
+
+	DiskCache.Save(FBPSizeDiskCache::GetDefaultFilename());
+}
+
+void UBPSizeChecker::BeginDestroy()
+{
+	if (RequestBroker)
+	{
+		RequestBroker->CancelAll();
+	}
+	SizeCallbacks.Empty();
+
+	for (const TPair<TWeakObjectPtr<UBlueprint>, FDelegateHandle>& compiledHandle : CompiledHandles)
+	{
+		if (UBlueprint* blueprint = compiledHandle.Key.Get())
+		{
+			blueprint->OnCompiled().Remove(compiledHandle.Value);
+		}
+	}
+	CompiledHandles.Empty();
+
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+
+	if (AssetUpdatedOnDiskHandle.IsValid())
+	{
+		if (IAssetRegistry* assetRegistry = IAssetRegistry::Get())
+		{
+			assetRegistry->OnAssetUpdatedOnDisk().Remove(AssetUpdatedOnDiskHandle);
+			assetRegistry->OnAssetAdded().Remove(AssetAddedHandle);
+			assetRegistry->OnAssetRemoved().Remove(AssetRemovedHandle);
+			assetRegistry->OnAssetRenamed().Remove(AssetRenamedHandle);
+		}
+		AssetUpdatedOnDiskHandle.Reset();
+		AssetAddedHandle.Reset();
+		AssetRemovedHandle.Reset();
+		AssetRenamedHandle.Reset();
+	}
+
+	if (AssetClosedHandle.IsValid() && GEditor)
+	{
+		if (UAssetEditorSubsystem* assetEditorSubsystem = GEditor->GetEditorSubsystem<UAssetEditorSubsystem>())
+		{
+			assetEditorSubsystem->OnAssetClosedInEditor().Remove(AssetClosedHandle);
+		}
+		AssetClosedHandle.Reset();
+	}
+
+	if (EnginePreExitHandle.IsValid())
+	{
+		FCoreDelegates::OnEnginePreExit.Remove(EnginePreExitHandle);
+		EnginePreExitHandle.Reset();
+		SaveDiskCache();
+	}
+
+	Super::BeginDestroy();
+}
+
+UBlueprint* UBPSizeChecker::TryExtractBlueprintFromContext(const FToolMenuContext& ToolMenuContext)
+{
+	UObject* obj = ToolMenuContext.FindByClass(UBlueprintEditorToolMenuContext::StaticClass());
+	if (!obj)
+	{
+		return nullptr;
+	}
+	UBlueprintEditorToolMenuContext* ctx = Cast<UBlueprintEditorToolMenuContext>(obj);
+
+	if (!ctx)
+	{
+		return nullptr;
+	}
+
+	UBlueprint* bp = ctx->GetBlueprintObj();
+	if (bp)
+	{
+		// Whatever the toolbar shows gets a size estimate on every compile, without waiting for the save
+		TrackBlueprintCompiles(bp);
+	}
 	return bp;
 }
\ No newline at end of file
@@ -4,13 +4,121 @@
 #include "UObject/NoExportTypes.h"
 #include "AssetManagerEditorModule.h"
 #include "ITreeMap.h"
+#include "BPSizeChunkIndex.h"
+#include "BPSizeDiskCache.h"
+#include "BPSizeDominatorTree.h"
+#include "BPSizeGraph.h"
+#include "BPSizeLazyTree.h"
+#include "BPSizeManagerIndex.h"
+#include "BPSizePackageClassifier.h"
+#include "BPSizeReferencerIndex.h"
+#include "BPSizeRequestBroker.h"
+#include "BPSizeResultCache.h"
+#include "Containers/Ticker.h"
+#include "Misc/MemStack.h"
 #include "BPSizeChecker.generated.h"
 
+class IAssetEditorInstance;
+class UBlueprint;
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnAssetSizeCalculated, FName, PackageName, const FString&, Size);
+
+USTRUCT(BlueprintType)
+struct FBPAssetSizeEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FName PackageName;
+
+	// Size of the package and everything it hard references
+	UPROPERTY(BlueprintReadOnly)
+	int64 Size = 0;
+
+	// Part of Size that none of the other packages in the same query pull in
+	UPROPERTY(BlueprintReadOnly)
+	int64 ExclusiveSize = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool HasKnownSize = false;
+
+	// Number of packages in the closure, including the package itself
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumPackages = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FBPAssetSizeChangeEdge
+{
+	GENERATED_BODY()
+
+	// Was in the closure before, DependencyName wasn't
+	UPROPERTY(BlueprintReadOnly)
+	FName ReferencerName;
+
+	UPROPERTY(BlueprintReadOnly)
+	FName DependencyName;
+
+	// Size of the new packages pulled in through the edge
+	UPROPERTY(BlueprintReadOnly)
+	int64 Size = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumPackages = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FBPAssetRetainedSize
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FName PackageName;
+
+	// The closest package every hard reference path from the root to this one goes through
+	UPROPERTY(BlueprintReadOnly)
+	FName DominatorName;
+
+	// What would leave the closure if nothing referenced the package anymore, the package itself included
+	UPROPERTY(BlueprintReadOnly)
+	int64 RetainedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool HasKnownSize = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumRetainedPackages = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FBPAssetReferencerEntry
+{
+	GENERATED_BODY()
+
+	// The blueprint whose closure contains the asset
+	UPROPERTY(BlueprintReadOnly)
+	FName PackageName;
+
+	// From the blueprint down to the asset, both included, along the shortest chain of hard references
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FName> ReferencePath;
+
+	// What would leave the closure of the blueprint without the asset: the asset and everything the blueprint only reaches through it
+	UPROPERTY(BlueprintReadOnly)
+	int64 ContributedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool HasKnownSize = false;
+};
+
 UCLASS(BlueprintType)
 class UBPSizeChecker : public UObject
 {
 	GENERATED_BODY()
 
+	// Runs the tree walk over synthetic graphs
+	friend class FBPSizeGatherTest;
+
 private:
 	struct FNodeSizeMapData
 	{
@@ -20,58 +128,260 @@ private:
 		/** Whether it has a known size or not */
 		bool bHasKnownSize;
 
-		/** Data from the asset registry about this asset */
-		FAssetData AssetData;
+		/** Whether the registry knows the asset, the ones it doesn't count as failed to load */
+		bool bIsValid = false;
+
+		/** Only what the labels need from the registry data, whole FAssetData copies with their tags are far bigger */
+		FName PackageName;
+		FName AssetName;
+		FTopLevelAssetPath AssetClassPath;
+
+		/** Set for the virtual nodes standing for primary assets */
+		FPrimaryAssetId PrimaryAssetId;
 	};
 
-	struct FAssetSizeData
+	struct FVisitedTreeMapNode
 	{
-		FName PackageName;
-		bool IsDirty = true;
-		int64 Size = 0;
-		int64 InitialSize = 0;
-		bool HasKnownSize = false;
+		TSharedPtr<FTreeMapNodeData> Node;
+
+		/** Index of the root-level asset this node was added under */
+		int32 RootLevelAsset;
 	};
+
+	struct FGatherFrame
+	{
+		TSharedPtr<FTreeMapNodeData> Node;
+		TArray<FAssetIdentifier, TMemStackAllocator<>> AssetIdentifiers;
+		FPrimaryAssetId FilterPrimaryAsset;
+
+		/** INDEX_NONE for the frame of the tree root itself */
+		int32 RootLevelAsset;
+		int32 NextIndex;
+	};
+
+	typedef TMap<TSharedRef<FTreeMapNodeData>, FNodeSizeMapData> FNodeSizeMapDataMap;
+
+	// Everything one size tree build works on, so builds never share state through the checker
+	struct FSizeTreeBuild
+	{
+		TArray<FAssetIdentifier> RootAssetIdentifiers;
+		FNodeSizeMapDataMap NodeSizeMapDataMap;
+		FName SizeType;
+
+		// Reused for every node, the registry only fills in default allocated arrays
+		TArray<FAssetIdentifier> References;
+	};
+
+	// Fills in the data of a node seen for the first time and the references to walk below it,
+	// the filter the walk applies below the node starts out as the one it was found with
+	typedef TFunctionRef<void(const FAssetIdentifier& AssetIdentifier, const FPrimaryAssetId& FilterPrimaryAsset, FNodeSizeMapData& NodeSizeMapData,
+		TArray<FAssetIdentifier, TMemStackAllocator<>>& ReferencedAssetIdentifiers, FPrimaryAssetId& ChildFilterPrimaryAsset)> FResolveGatherNode;
 	
 	IAssetManagerEditorModule* EditorModule = nullptr;
 	const FAssetManagerEditorRegistrySource* CurrentRegistrySource = nullptr;
-	
-	TArray<FAssetIdentifier> RootAssetIdentifiers;
 
-	typedef TMap<TSharedRef<FTreeMapNodeData>, FNodeSizeMapData> FNodeSizeMapDataMap;
-	FNodeSizeMapDataMap NodeSizeMapDataMap;
+	// Editors stay open for days, so the results of every package ever shown have to fit a budget
+	FBPSizeResultCache ResultCache;
 
-	TMap<FName, FAssetSizeData> FileSizeDataCache;
-	
-	FName SizeType;
+	TUniquePtr<FBPSizeGraph> SizeGraph;
+	TUniquePtr<FBPSizeManagerIndex> ManagerIndex;
+	TUniquePtr<FBPSizeChunkIndex> ChunkIndex;
+
+	// Package data and baselines from earlier editor sessions, written back when the checker goes away
+	FBPSizeDiskCache DiskCache;
+	bool IsDiskCacheLoaded = false;
+	FDelegateHandle EnginePreExitHandle;
+
+	// Closure calculations in flight, every package pending at once gets walked in the same round
+	TUniquePtr<FBPSizeRequestBroker> RequestBroker;
+	TMap<FName, TArray<FOnAssetSizeCalculated>> SizeCallbacks;
+
+	// Saved packages wait here until the saves stop coming, then get invalidated a few per tick.
+	// The calculations they affect are restarted once, after the last of them.
+	TSet<FName> DirtyPackages;
+	TArray<FName> InvalidatingPackages;
+	TSet<FName> AffectedPackages;
+	double LastInvalidationTime = 0.0;
+
+	// How the closures of blueprints compiled since their last save would change, shown next to the saved size
+	TMap<FName, FBPSizeClosureEstimate> CompileEstimates;
 
-	// This method is a copy of the SSizeMap::GatherDependenciesRecursively one from the engine source code
-	void GatherDependenciesRecursively(
-		TMap<FAssetIdentifier, TSharedPtr<FTreeMapNodeData>>& VisitedAssetIdentifiers,
-		const TArray<FAssetIdentifier>& AssetIdentifiers,
+	// Built by the first referencer query, then kept up to date after every save. Blueprints are resolved into the graph
+	// once, so the index covers all of them, and the ones saved, added or renamed later are resolved before the next query.
+	FBPSizeReferencerIndex ReferencerIndex;
+	bool IsReferencerIndexUsed = false;
+	TSet<FName> BlueprintPackages;
+	TSet<FName> PendingBlueprintPackages;
+	TMap<TWeakObjectPtr<UBlueprint>, FDelegateHandle> CompiledHandles;
+	FTSTicker::FDelegateHandle TickerHandle;
+	FDelegateHandle AssetClosedHandle;
+	FDelegateHandle AssetUpdatedOnDiskHandle;
+	FDelegateHandle AssetAddedHandle;
+	FDelegateHandle AssetRemovedHandle;
+	FDelegateHandle AssetRenamedHandle;
+
+	// This method is based on the SSizeMap::GatherDependenciesRecursively one from the engine source code.
+	// It walks the references with an explicit stack instead of recursing, and builds the same tree.
+	// Everything it knows about the assets comes from ResolveNode, the walk itself never touches the registry.
+	static void GatherDependencies(
+		FSizeTreeBuild& Build,
+		TMap<FAssetIdentifier, FVisitedTreeMapNode>& VisitedAssetIdentifiers,
 		const FPrimaryAssetId& FilterPrimaryAsset,
-		const TSharedPtr<FTreeMapNodeData>& ParentTreeMapNode,
+		const TSharedPtr<FTreeMapNodeData>& RootTreeMapNode,
 		TSharedPtr<FTreeMapNodeData>& SharedRootNode,
-		int32& NumAssetsWhichFailedToLoad);
+		int32& NumAssetsWhichFailedToLoad,
+		FResolveGatherNode ResolveNode);
+
+	// The registry half of SSizeMap::GatherDependenciesRecursively: the asset data, size and filtered references of a node
+	void ResolveGatherNode(
+		FSizeTreeBuild& Build,
+		const FAssetIdentifier& AssetIdentifier,
+		const FPrimaryAssetId& FilterPrimaryAsset,
+		FNodeSizeMapData& NodeSizeMapData,
+		TArray<FAssetIdentifier, TMemStackAllocator<>>& ReferencedAssetIdentifiers,
+		FPrimaryAssetId& ChildFilterPrimaryAsset);
 
 	// This method is a copy of the SSizeMap::FinalizeNodesRecursively one from the engine source code
-	void FinalizeNodesRecursively(
+	static void FinalizeNodesRecursively(
+		FSizeTreeBuild& Build,
 		TSharedPtr<FTreeMapNodeData>& Node,
 		const TSharedPtr<FTreeMapNodeData>& SharedRootNode,
 		int32& TotalAssetCount,
 		SIZE_T& TotalSize,
 		bool& bAnyUnknownSizes);
 
-	const FAssetSizeData& CalculateAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate);
-	void FormatAssetSize(const FAssetSizeData& SizeData, FString& OutDisplayString);
+	// Builds the tree for any set of roots, only following packages managed by FilterPrimaryAsset when it's valid
+	TSharedPtr<FTreeMapNodeData> BuildSizeTree(
+		const TArray<FAssetIdentifier>& Roots,
+		const FPrimaryAssetId& FilterPrimaryAsset,
+		const FName& SizeTypeToCalculate,
+		SIZE_T& OutTotalSize,
+		bool& OutHasKnownSize);
+
+	void FinishCalculation(const FBPSizeRequestBroker::FRequest& Request, const FBPSizeClosureResult& Result);
+	void RecordClosure(FBPSizeResult& SizeData, const FBPSizeClosureResult& Result, int32 Generation, int32 SizeTypeIndex);
+	bool TickCalculations(float DeltaTime);
+	void FlushInvalidations(double EndTime);
+	void OnAssetClosedInEditor(UObject* Asset, IAssetEditorInstance* AssetEditorInstance);
+	void OnAssetUpdatedOnDisk(const FAssetData& AssetData);
+
+	// Keep the blueprints the referencer queries report in step with the registry
+	void OnAssetAdded(const FAssetData& AssetData);
+	void OnAssetRemoved(const FAssetData& AssetData);
+	void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath);
+
+	void TrackBlueprintCompiles(UBlueprint* Blueprint);
+	void UntrackBlueprintCompiles(UBlueprint* Blueprint);
+	void OnBlueprintCompiled(UBlueprint* Blueprint);
+	bool UpdateCompileEstimate(UBlueprint* Blueprint);
+	void AppendCompileEstimate(const FName& PackageName, const FBPSizeResult& SizeData, int32 SizeTypeIndex, FString& OutDisplayString) const;
+
+	// Packages the game part of the in-memory blueprint hard references, which may differ from the saved ones the registry knows
+	static void GatherInMemoryDependencies(UBlueprint* Blueprint, TArray<FName>& OutPackageNames);
+	void SaveDiskCache();
+
+	void FormatAssetSize(const FBPSizeResult& SizeData, int32 SizeTypeIndex, FString& OutDisplayString);
+
+	// The sizes of the given types separated by slashes. A calculation started from here is attributed to SizeTypeToCalculate.
+	void GetFormattedAssetSize(const FName& PackageName, TConstArrayView<int32> SizeTypeIndices, const FName& SizeTypeToCalculate, FString& OutSize);
 	
 public:
+	virtual void BeginDestroy() override;
+
+	// Builds the full SizeMap style breakdown. Only needed when the individual dependencies are of interest,
+	// the toolbar number comes from the closure calculation which skips the tree entirely
+	TSharedPtr<FTreeMapNodeData> BuildAssetSizeTree(const FName& PackageName, const FName& SizeTypeToCalculate);
+
+	// The same breakdown for drill-down views, which only look at a few levels of it. Only the subtree totals
+	// are computed here, nodes get created when their parent is expanded.
+	TSharedPtr<FBPSizeLazyTree> BuildLazySizeTree(const FName& PackageName, const FName& SizeTypeToCalculate);
+
+	// Node of the lazy tree labeled the way BuildAssetSizeTree labels it, without any children yet
+	TSharedRef<FTreeMapNodeData> MakeLazySizeTreeNode(const FBPSizeLazyTree& Tree, int32 NodeId);
+
+	// Creates, labels and sorts the children of the node, plus a *SELF* node for its own size.
+	// OutChildNodeIds matches Node.Children, the *SELF* node has INDEX_NONE.
+	void ExpandLazySizeTreeNode(FBPSizeLazyTree& Tree, int32 NodeId, const TSharedRef<FTreeMapNodeData>& Node, TArray<int32>& OutChildNodeIds);
+
 	UFUNCTION(BlueprintCallable)
 	void Init();
 	
+	// Never blocks. Starts a calculation if the cached size is stale and reports it as calculating until it finishes
 	UFUNCTION(BlueprintCallable)
 	void GetAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate, FString& OutSize);
 
+	// The same as GetAssetSize, as "memory / disk". Both come from the same calculation.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetMemoryAndDiskSize(const FName& PackageName, FString& OutSize);
+
+	// What the closure grows to with editor-only and soft references followed too, walked along with the hard size.
+	// Never blocks. Starts a calculation walking every dependency mode when the last one didn't, empty until there is one.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetSoftReferencePotential(const FName& PackageName, const FName& SizeTypeToCalculate, FString& OutSize);
+
+	// Recalculates the size in the background, cancelling a calculation already running for the package
+	UFUNCTION(BlueprintCallable)
+	void RequestAssetSize(const FName& PackageName, const FName& SizeTypeToCalculate, const FOnAssetSizeCalculated& OnCalculated);
+
+	UFUNCTION(BlueprintCallable)
+	void CancelAssetSizeRequest(const FName& PackageName);
+
+	// Size the blueprint would have with its in-memory references, before it gets saved. Blocks, but only
+	// walks the closures of the references which differ from the saved ones.
+	UFUNCTION(BlueprintCallable)
+	void EstimateBlueprintSize(UBlueprint* Blueprint, const FName& SizeTypeToCalculate, FString& OutSize);
+
+	// Which edges pulled in the packages that entered the closure at its last recalculation, biggest first,
+	// and how much left it. Comes from the cached closures, nothing gets walked again.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetSizeChange(const FName& PackageName, TArray<FBPAssetSizeChangeEdge>& OutAddedEdges, int64& OutAddedSize, int64& OutRemovedSize);
+
+	// The same as GetAssetSizeChange, formatted for the tooltip of the toolbar
+	UFUNCTION(BlueprintCallable)
+	void GetAssetSizeChangeTooltip(const FName& PackageName, FString& OutTooltip);
+
+	// Size of everything the primary asset manages, the same total the SizeMap shows for it. Blocks.
+	UFUNCTION(BlueprintCallable)
+	void GetPrimaryAssetSize(const FPrimaryAssetId& PrimaryAssetId, const FName& SizeTypeToCalculate, FString& OutSize);
+
+	// Size of what loading the bundle of the primary asset brings in, limited to packages the primary asset manages. Blocks.
+	UFUNCTION(BlueprintCallable)
+	void GetPrimaryAssetBundleSize(const FPrimaryAssetId& PrimaryAssetId, const FName& BundleName, const FName& SizeTypeToCalculate, FString& OutSize);
+
+	// Size of everything the registry source assigns to the chunk. Only cooked registry sources have chunks. Blocks.
+	UFUNCTION(BlueprintCallable)
+	void GetChunkSize(int32 ChunkId, const FName& SizeTypeToCalculate, FString& OutSize);
+
+	// Chunks the package and its hard references end up in, sorted. Blocks.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetChunks(const FName& PackageName, TArray<int32>& OutChunkIds);
+
+	// Retained sizes of the packages in the closure, biggest first, at most MaxEntries of them when it's positive.
+	// The ones the root dominates directly are the references worth cutting. Blocks, but only the first time walks the registry.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetRetainedSizes(const FName& PackageName, const FName& SizeTypeToCalculate, int32 MaxEntries, TArray<FBPAssetRetainedSize>& OutEntries);
+
+	// Every blueprint whose hard closure contains the package, closest first. The first call resolves all the blueprints
+	// of the project to build the referencer index and blocks for a while, later ones walk the index and the closure of the package.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetReferencers(const FName& PackageName, const FName& SizeTypeToCalculate, TArray<FBPAssetReferencerEntry>& OutEntries);
+
+	// Sizes many packages with a single shared traversal, meant for reports rather than the toolbar, so it blocks.
+	// OutOverlapSize is the size of everything reached from more than one of the packages.
+	UFUNCTION(BlueprintCallable)
+	void GetAssetSizes(const TArray<FName>& PackageNames, const FName& SizeTypeToCalculate, TArray<FBPAssetSizeEntry>& OutSizes, int64& OutOverlapSize);
+
+	// Times the closure walk at several thread counts, against the condensed batch path, the size tree, the lazy tree
+	// and the dominator tree.
+	// Backs the BPSize.ClosureScaling console command.
+	bool LogClosureScaling(const FName& PackageName, const FName& SizeTypeToCalculate);
+
+	// Backs the BPSize.SizeProviderStats console command
+	bool LogSizeProviderStats(bool ResetCounters);
+
+	// Backs the BPSize.ResultCacheStats console command
+	bool LogResultCacheStats(bool ResetCounters);
+
 	UFUNCTION(BlueprintCallable)
 	UBlueprint* TryExtractBlueprintFromContext(const FToolMenuContext& ToolMenuContext);
 };
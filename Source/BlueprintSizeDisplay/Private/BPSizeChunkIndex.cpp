@@ -0,0 +1,74 @@
+#include "BPSizeChunkIndex.h"
+
+FBPSizeChunkIndex::FBPSizeChunkIndex(const FAssetManagerEditorRegistrySource& InRegistrySource) :
+	RegistrySource(InRegistrySource)
+{
+}
+
+void FBPSizeChunkIndex::Build()
+{
+	IsBuilt = true;
+	Chunks.Empty(RegistrySource.ChunkAssignments.Num());
+	PackageChunks.Empty();
+
+	for (const TPair<int32, FAssetManagerChunkInfo>& chunkAssignment : RegistrySource.ChunkAssignments)
+	{
+		const int32 chunkId = chunkAssignment.Key;
+
+		FChunk& chunk = Chunks.Add(chunkId);
+		chunk.ExplicitAssets = chunkAssignment.Value.ExplicitAssets.Array();
+		chunk.Packages.Reserve(chunkAssignment.Value.AllAssets.Num());
+
+		for (const FAssetIdentifier& asset : chunkAssignment.Value.AllAssets)
+		{
+			if (asset.IsPackage())
+			{
+				chunk.Packages.Add(asset.PackageName);
+				PackageChunks.FindOrAdd(asset.PackageName).Add(chunkId);
+			}
+		}
+	}
+
+	for (TPair<FName, TArray<int32, TInlineAllocator<2>>>& packageChunks : PackageChunks)
+	{
+		packageChunks.Value.Sort();
+	}
+}
+
+const TArray<FAssetIdentifier>* FBPSizeChunkIndex::FindExplicitAssets(int32 ChunkId)
+{
+	if (!IsBuilt)
+	{
+		Build();
+	}
+
+	const FChunk* chunk = Chunks.Find(ChunkId);
+	return chunk ? &chunk->ExplicitAssets : nullptr;
+}
+
+const TArray<FName>* FBPSizeChunkIndex::FindChunkPackages(int32 ChunkId)
+{
+	if (!IsBuilt)
+	{
+		Build();
+	}
+
+	const FChunk* chunk = Chunks.Find(ChunkId);
+	return chunk ? &chunk->Packages : nullptr;
+}
+
+bool FBPSizeChunkIndex::IsPackageInChunk(const FName& PackageName, int32 ChunkId)
+{
+	return GetPackageChunks(PackageName).Contains(ChunkId);
+}
+
+TConstArrayView<int32> FBPSizeChunkIndex::GetPackageChunks(const FName& PackageName)
+{
+	if (!IsBuilt)
+	{
+		Build();
+	}
+
+	const TArray<int32, TInlineAllocator<2>>* packageChunks = PackageChunks.Find(PackageName);
+	return packageChunks ? TConstArrayView<int32>(*packageChunks) : TConstArrayView<int32>();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManagerEditorModule.h"
+
+// Flattened copy of the registry source's chunk assignments, built the first time it's needed.
+// Answers "is this package in that chunk" and "which chunks is this package in" with a single hash lookup.
+class FBPSizeChunkIndex
+{
+public:
+	explicit FBPSizeChunkIndex(const FAssetManagerEditorRegistrySource& InRegistrySource);
+
+	const TArray<FAssetIdentifier>* FindExplicitAssets(int32 ChunkId);
+	const TArray<FName>* FindChunkPackages(int32 ChunkId);
+
+	bool IsPackageInChunk(const FName& PackageName, int32 ChunkId);
+
+	// Empty for packages no chunk contains, which is every package of the editor's own registry
+	TConstArrayView<int32> GetPackageChunks(const FName& PackageName);
+
+	// The next query rebuilds the index
+	void Reset() { IsBuilt = false; }
+
+private:
+	struct FChunk
+	{
+		TArray<FAssetIdentifier> ExplicitAssets;
+		TArray<FName> Packages;
+	};
+
+	void Build();
+
+	const FAssetManagerEditorRegistrySource& RegistrySource;
+	bool IsBuilt = false;
+
+	TMap<int32, FChunk> Chunks;
+
+	// Chunk ids per package, sorted. Most packages are in one chunk, a few are duplicated into more.
+	TMap<FName, TArray<int32, TInlineAllocator<2>>> PackageChunks;
+};
@@ -0,0 +1,216 @@
+#include "BPSizeCondensation.h"
+
+#include "Algo/BinarySearch.h"
+#include "BPSizeGraph.h"
+
+int32 FBPSizeSparseBitSet::CountSetBits() const
+{
+	int32 numSetBits = 0;
+	for (const uint64 word : Words)
+	{
+		numSetBits += FMath::CountBits(word);
+	}
+	return numSetBits;
+}
+
+bool FBPSizeSparseBitSet::Contains(int32 Index) const
+{
+	const int32 wordOrdinal = Algo::BinarySearch(WordIndices, Index >> 6);
+	return wordOrdinal != INDEX_NONE && (Words[wordOrdinal] & (1ull << (Index & 63))) != 0;
+}
+
+void FBPSizeCondensation::Build(const FBPSizeGraphSnapshot& Snapshot, TConstArrayView<int32> RootIndices)
+{
+	const int32 numPackages = Snapshot.GetNumPackages();
+	const int32 numWords = FMath::DivideAndRoundUp(numPackages, 64);
+
+	ComponentOfPackage.Init(INDEX_NONE, numPackages);
+	ComponentClosures.Reset();
+
+	// Tarjan's algorithm with an explicit stack, the graphs are far too deep to recurse on
+	struct FFrame
+	{
+		int32 PackageIndex = INDEX_NONE;
+		int32 NextEdge = 0;
+	};
+
+	TArray<int32> discoveryOrder;
+	discoveryOrder.Init(INDEX_NONE, numPackages);
+	TArray<int32> lowLinks;
+	lowLinks.Init(0, numPackages);
+	TBitArray<> onStack(false, numPackages);
+	TArray<int32> componentStack;
+	TArray<FFrame> callStack;
+	int32 nextDiscovery = 0;
+
+	// Closures get merged in a dense scratch, only the touched words have to be cleared again
+	TArray<uint64> scratchWords;
+	scratchWords.Init(0, numWords);
+	TArray<int32> touchedWords;
+
+	// Which component a successor was last merged into, so every successor is merged once per component
+	TArray<int32> lastMergedInto;
+
+	auto setScratchWord = [&scratchWords, &touchedWords](int32 WordIndex, uint64 Word)
+	{
+		if (scratchWords[WordIndex] == 0)
+		{
+			touchedWords.Add(WordIndex);
+		}
+		scratchWords[WordIndex] |= Word;
+	};
+
+	auto discover = [&](int32 PackageIndex)
+	{
+		discoveryOrder[PackageIndex] = nextDiscovery;
+		lowLinks[PackageIndex] = nextDiscovery;
+		++nextDiscovery;
+
+		onStack[PackageIndex] = true;
+		componentStack.Add(PackageIndex);
+		callStack.Add({ PackageIndex, Snapshot.DependencyOffsets[PackageIndex] });
+	};
+
+	// Tarjan finishes a component only after all the components it reaches,
+	// so their closures are always there to be merged
+	auto finishComponent = [&](int32 ComponentRootIndex)
+	{
+		const int32 componentIndex = ComponentClosures.Num();
+		lastMergedInto.Add(INDEX_NONE);
+
+		int32 firstMember = componentStack.Num() - 1;
+		while (componentStack[firstMember] != ComponentRootIndex)
+		{
+			--firstMember;
+		}
+
+		for (int32 memberOrdinal = firstMember; memberOrdinal < componentStack.Num(); ++memberOrdinal)
+		{
+			const int32 memberIndex = componentStack[memberOrdinal];
+			onStack[memberIndex] = false;
+			ComponentOfPackage[memberIndex] = componentIndex;
+			setScratchWord(memberIndex >> 6, 1ull << (memberIndex & 63));
+		}
+
+		for (int32 memberOrdinal = firstMember; memberOrdinal < componentStack.Num(); ++memberOrdinal)
+		{
+			const int32 memberIndex = componentStack[memberOrdinal];
+			for (int32 edge = Snapshot.DependencyOffsets[memberIndex]; edge < Snapshot.DependencyOffsets[memberIndex + 1]; ++edge)
+			{
+				if (!BPSizeDependencyModes::IsHardGame(Snapshot.DependencyModes[edge]))
+				{
+					continue;
+				}
+
+				const int32 successorComponent = ComponentOfPackage[Snapshot.DependencyIndices[edge]];
+				if (successorComponent == componentIndex || lastMergedInto[successorComponent] == componentIndex)
+				{
+					continue;
+				}
+				lastMergedInto[successorComponent] = componentIndex;
+
+				const FBPSizeSparseBitSet& successorClosure = ComponentClosures[successorComponent];
+				for (int32 wordOrdinal = 0; wordOrdinal < successorClosure.Words.Num(); ++wordOrdinal)
+				{
+					setScratchWord(successorClosure.WordIndices[wordOrdinal], successorClosure.Words[wordOrdinal]);
+				}
+			}
+		}
+
+		componentStack.SetNum(firstMember, false);
+
+		touchedWords.Sort();
+		FBPSizeSparseBitSet& closure = ComponentClosures.AddDefaulted_GetRef();
+		closure.WordIndices = touchedWords;
+		closure.Words.Reserve(touchedWords.Num());
+		for (const int32 wordIndex : touchedWords)
+		{
+			closure.Words.Add(scratchWords[wordIndex]);
+			scratchWords[wordIndex] = 0;
+		}
+		touchedWords.Reset();
+	};
+
+	for (const int32 rootIndex : RootIndices)
+	{
+		if (rootIndex == INDEX_NONE || discoveryOrder[rootIndex] != INDEX_NONE)
+		{
+			continue;
+		}
+
+		discover(rootIndex);
+
+		while (!callStack.IsEmpty())
+		{
+			FFrame& frame = callStack.Last();
+			const int32 packageIndex = frame.PackageIndex;
+
+			if (frame.NextEdge < Snapshot.DependencyOffsets[packageIndex + 1])
+			{
+				const int32 edge = frame.NextEdge++;
+				const int32 dependencyIndex = Snapshot.DependencyIndices[edge];
+				if (!BPSizeDependencyModes::IsHardGame(Snapshot.DependencyModes[edge]))
+				{
+					continue;
+				}
+
+				if (discoveryOrder[dependencyIndex] == INDEX_NONE)
+				{
+					discover(dependencyIndex);
+				}
+				else if (onStack[dependencyIndex])
+				{
+					lowLinks[packageIndex] = FMath::Min(lowLinks[packageIndex], discoveryOrder[dependencyIndex]);
+				}
+				continue;
+			}
+
+			callStack.Pop(false);
+			if (!callStack.IsEmpty())
+			{
+				const int32 parentIndex = callStack.Last().PackageIndex;
+				lowLinks[parentIndex] = FMath::Min(lowLinks[parentIndex], lowLinks[packageIndex]);
+			}
+
+			if (lowLinks[packageIndex] == discoveryOrder[packageIndex])
+			{
+				finishComponent(packageIndex);
+			}
+		}
+	}
+}
+
+const FBPSizeSparseBitSet& FBPSizeCondensation::GetClosure(int32 PackageIndex) const
+{
+	return ComponentClosures[ComponentOfPackage[PackageIndex]];
+}
+
+int64 FBPSizeCondensation::SumMasked(const FBPSizeSparseBitSet& BitSet, TConstArrayView<uint64> ExcludedWords, TConstArrayView<int64> Sizes)
+{
+	int64 sum = 0;
+	for (int32 wordOrdinal = 0; wordOrdinal < BitSet.Words.Num(); ++wordOrdinal)
+	{
+		const int32 wordIndex = BitSet.WordIndices[wordOrdinal];
+		const uint64 word = BitSet.Words[wordOrdinal] & ~ExcludedWords[wordIndex];
+
+		const int32 firstPackage = wordIndex * 64;
+		const int32 numPackages = FMath::Min(64, Sizes.Num() - firstPackage);
+		const int64* sizes = Sizes.GetData() + firstPackage;
+
+		for (int32 bit = 0; bit < numPackages; ++bit)
+		{
+			sum += sizes[bit] & -static_cast<int64>((word >> bit) & 1);
+		}
+	}
+	return sum;
+}
+
+void FBPSizeCondensation::ToWords(const TBitArray<>& BitArray, TArray<uint64>& OutWords)
+{
+	OutWords.Init(0, FMath::DivideAndRoundUp(BitArray.Num(), 64));
+	for (TConstSetBitIterator<> it(BitArray); it; ++it)
+	{
+		const int32 bitIndex = it.GetIndex();
+		OutWords[bitIndex >> 6] |= 1ull << (bitIndex & 63);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBPSizeGraphSnapshot;
+
+// Bit set over package indices that only stores its non-zero 64 bit words, sorted by word index.
+// Closures are mostly small compared to the whole graph, so this keeps them cheap to hold on to and to merge.
+struct FBPSizeSparseBitSet
+{
+	TArray<int32> WordIndices;
+	TArray<uint64> Words;
+
+	int32 CountSetBits() const;
+	bool Contains(int32 Index) const;
+};
+
+// Dependency graph collapsed into its strongly connected components.
+// Every package of a cycle has the same closure, so it's worked out once per component, and components further down
+// the graph are shared by everything above them instead of being walked again for every root.
+class FBPSizeCondensation
+{
+public:
+	// Only the part of the snapshot reachable from the roots gets condensed
+	void Build(const FBPSizeGraphSnapshot& Snapshot, TConstArrayView<int32> RootIndices);
+
+	// Closure of a package reached from one of the roots, the package itself included
+	const FBPSizeSparseBitSet& GetClosure(int32 PackageIndex) const;
+
+	int32 GetNumComponents() const { return ComponentClosures.Num(); }
+
+	// Sums up the sizes of the packages in the bit set, leaving out the ones set in the dense ExcludedWords.
+	// Every word is laid over the contiguous size array, so the inner loop has no branches and vectorizes.
+	static int64 SumMasked(const FBPSizeSparseBitSet& BitSet, TConstArrayView<uint64> ExcludedWords, TConstArrayView<int64> Sizes);
+
+	// The bit array words of the snapshot come in 32 bit pieces, the sums want them as 64 bit words
+	static void ToWords(const TBitArray<>& BitArray, TArray<uint64>& OutWords);
+
+private:
+	TArray<int32> ComponentOfPackage;
+	TArray<FBPSizeSparseBitSet> ComponentClosures;
+};
@@ -0,0 +1,309 @@
+#include "BPSizeDiskCache.h"
+
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 CacheFileMagic = 0x43535042; // "BPSC"
+
+	// Bump whenever the layout changes, older files are then ignored
+	constexpr uint32 CacheFileVersion = 4;
+}
+
+FString FBPSizeDiskCache::GetDefaultFilename()
+{
+	return FPaths::ProjectSavedDir() / TEXT("BlueprintSizeDisplay") / TEXT("SizeCache.bin");
+}
+
+void FBPSizeDiskCache::SetContext(const FString& InSourceName, const TArray<FName>& InSizeTypes)
+{
+	if (SourceName != InSourceName)
+	{
+		Baselines.Empty();
+	}
+
+	if (SourceName != InSourceName || SizeTypes != InSizeTypes)
+	{
+		Packages.Empty();
+		SourceName = InSourceName;
+		SizeTypes = InSizeTypes;
+	}
+}
+
+const FBPSizeDiskCache::FPackageEntry* FBPSizeDiskCache::FindPackage(const FName& PackageName, const FIoHash& CurrentSavedHash) const
+{
+	const FPackageEntry* entry = Packages.Find(PackageName);
+	if (!entry || CurrentSavedHash.IsZero() || entry->SavedHash != CurrentSavedHash)
+	{
+		return nullptr;
+	}
+
+	return entry;
+}
+
+void FBPSizeDiskCache::AddPackage(const FName& PackageName, FPackageEntry&& Entry)
+{
+	Packages.Add(PackageName, MoveTemp(Entry));
+}
+
+const int64* FBPSizeDiskCache::FindBaseline(const FName& PackageName, const FName& SizeType) const
+{
+	return Baselines.Find(MakeTuple(PackageName, SizeType));
+}
+
+void FBPSizeDiskCache::AddBaseline(const FName& PackageName, const FName& SizeType, int64 InitialSize)
+{
+	Baselines.Add(MakeTuple(PackageName, SizeType), InitialSize);
+}
+
+void FBPSizeDiskCache::RemovePackages(TFunctionRef<bool(const FName& PackageName)> ShouldRemove)
+{
+	for (TMap<FName, FPackageEntry>::TIterator it = Packages.CreateIterator(); it; ++it)
+	{
+		if (ShouldRemove(it.Key()))
+		{
+			it.RemoveCurrent();
+		}
+	}
+
+	for (TMap<TPair<FName, FName>, int64>::TIterator it = Baselines.CreateIterator(); it; ++it)
+	{
+		if (ShouldRemove(it.Key().Key))
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
+
+void FBPSizeDiskCache::Load(const FString& Filename)
+{
+	Packages.Empty();
+	Baselines.Empty();
+
+	// Every entry gets copied into the maps anyway, so the file is simply read in one go
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *Filename, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader reader(bytes);
+	Serialize(reader);
+
+	if (reader.IsError())
+	{
+		Packages.Empty();
+		Baselines.Empty();
+	}
+}
+
+bool FBPSizeDiskCache::Save(const FString& Filename) const
+{
+	TArray<uint8> bytes;
+	FMemoryWriter writer(bytes);
+	const_cast<FBPSizeDiskCache*>(this)->Serialize(writer);
+
+	return FFileHelper::SaveArrayToFile(bytes, *Filename);
+}
+
+void FBPSizeDiskCache::Serialize(FArchive& Ar)
+{
+	uint32 magic = CacheFileMagic;
+	uint32 version = CacheFileVersion;
+	Ar << magic;
+	Ar << version;
+
+	if (Ar.IsLoading() && (magic != CacheFileMagic || version != CacheFileVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << SourceName;
+
+	// Every package and size type name is stored once, entries and dependency lists refer to it by index
+	TArray<FName> nameTable;
+	TMap<FName, int32> nameIndices;
+	if (Ar.IsSaving())
+	{
+		auto addName = [&nameTable, &nameIndices](const FName& Name)
+		{
+			if (!nameIndices.Contains(Name))
+			{
+				nameIndices.Add(Name, nameTable.Add(Name));
+			}
+		};
+
+		for (const FName& sizeType : SizeTypes)
+		{
+			addName(sizeType);
+		}
+		for (const TPair<FName, FPackageEntry>& package : Packages)
+		{
+			addName(package.Key);
+			for (const FName& dependency : package.Value.Dependencies)
+			{
+				addName(dependency);
+			}
+		}
+		for (const TPair<TPair<FName, FName>, int64>& baseline : Baselines)
+		{
+			addName(baseline.Key.Key);
+			addName(baseline.Key.Value);
+		}
+	}
+
+	// A truncated or corrupt file must not get anything reserved for more elements than its remaining bytes can hold
+	auto isValidCount = [&Ar](int32 Count, int64 MinElementSize)
+	{
+		return Count >= 0 && Count <= (Ar.TotalSize() - Ar.Tell()) / MinElementSize;
+	};
+
+	int32 numNames = nameTable.Num();
+	Ar << numNames;
+	if (Ar.IsLoading())
+	{
+		if (!isValidCount(numNames, sizeof(int32)))
+		{
+			Ar.SetError();
+			return;
+		}
+		nameTable.SetNum(numNames);
+	}
+	for (FName& name : nameTable)
+	{
+		FString nameString = name.ToString();
+		Ar << nameString;
+		name = FName(*nameString);
+	}
+
+	auto serializeNameIndex = [&Ar, &nameTable, &nameIndices](FName& Name)
+	{
+		int32 nameIndex = Ar.IsSaving() ? nameIndices[Name] : INDEX_NONE;
+		Ar << nameIndex;
+		if (Ar.IsLoading())
+		{
+			if (!nameTable.IsValidIndex(nameIndex))
+			{
+				Ar.SetError();
+				return;
+			}
+			Name = nameTable[nameIndex];
+		}
+	};
+
+	int32 numSizeTypes = SizeTypes.Num();
+	Ar << numSizeTypes;
+	if (Ar.IsLoading())
+	{
+		if (!isValidCount(numSizeTypes, sizeof(int32)) || numSizeTypes > numNames)
+		{
+			Ar.SetError();
+			return;
+		}
+		SizeTypes.SetNum(numSizeTypes);
+	}
+	for (FName& sizeType : SizeTypes)
+	{
+		serializeNameIndex(sizeType);
+	}
+
+	int32 numPackages = Packages.Num();
+	Ar << numPackages;
+	if (Ar.IsSaving())
+	{
+		for (TPair<FName, FPackageEntry>& package : Packages)
+		{
+			serializeNameIndex(package.Key);
+			Ar << package.Value.SavedHash;
+			Ar << package.Value.SelfSizes;
+			Ar << package.Value.KnownSizes;
+
+			int32 numDependencies = package.Value.Dependencies.Num();
+			Ar << numDependencies;
+			for (int32 dependencyOrdinal = 0; dependencyOrdinal < numDependencies; ++dependencyOrdinal)
+			{
+				serializeNameIndex(package.Value.Dependencies[dependencyOrdinal]);
+				Ar << package.Value.DependencyModes[dependencyOrdinal];
+			}
+		}
+	}
+	else
+	{
+		// Name index, saved hash and the counts of the three arrays
+		if (!isValidCount(numPackages, 4 * sizeof(int32) + sizeof(FIoHash)))
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Packages.Reserve(numPackages);
+		for (int32 packageOrdinal = 0; packageOrdinal < numPackages && !Ar.IsError(); ++packageOrdinal)
+		{
+			FName packageName;
+			FPackageEntry entry;
+			serializeNameIndex(packageName);
+			Ar << entry.SavedHash;
+			Ar << entry.SelfSizes;
+			Ar << entry.KnownSizes;
+			if (entry.SelfSizes.Num() != numSizeTypes || entry.KnownSizes.Num() != numSizeTypes)
+			{
+				Ar.SetError();
+				return;
+			}
+
+			int32 numDependencies = 0;
+			Ar << numDependencies;
+			if (!isValidCount(numDependencies, sizeof(int32) + sizeof(uint8)) || numDependencies > numNames)
+			{
+				Ar.SetError();
+				return;
+			}
+
+			entry.Dependencies.SetNum(numDependencies);
+			entry.DependencyModes.SetNum(numDependencies);
+			for (int32 dependencyOrdinal = 0; dependencyOrdinal < numDependencies; ++dependencyOrdinal)
+			{
+				serializeNameIndex(entry.Dependencies[dependencyOrdinal]);
+				Ar << entry.DependencyModes[dependencyOrdinal];
+			}
+
+			Packages.Add(packageName, MoveTemp(entry));
+		}
+	}
+
+	int32 numBaselines = Baselines.Num();
+	Ar << numBaselines;
+	if (Ar.IsSaving())
+	{
+		for (TPair<TPair<FName, FName>, int64>& baseline : Baselines)
+		{
+			serializeNameIndex(baseline.Key.Key);
+			serializeNameIndex(baseline.Key.Value);
+			Ar << baseline.Value;
+		}
+	}
+	else
+	{
+		if (!isValidCount(numBaselines, 2 * sizeof(int32) + sizeof(int64)))
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Baselines.Reserve(numBaselines);
+		for (int32 baselineOrdinal = 0; baselineOrdinal < numBaselines && !Ar.IsError(); ++baselineOrdinal)
+		{
+			FName packageName;
+			FName sizeType;
+			int64 initialSize = 0;
+			serializeNameIndex(packageName);
+			serializeNameIndex(sizeType);
+			Ar << initialSize;
+			Baselines.Add(MakeTuple(packageName, sizeType), initialSize);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BPSizeGraph.h"
+#include "IO/IoHash.h"
+
+// Keeps what the size graph learned about packages across editor sessions, in a compact binary file under Saved/.
+// An entry is only trusted while the package's saved hash is the same as when it was written.
+class FBPSizeDiskCache
+{
+public:
+	struct FPackageEntry
+	{
+		FIoHash SavedHash;
+
+		// Per size type of the cache
+		TArray<int64> SelfSizes;
+		TBitArray<> KnownSizes;
+		TArray<FName> Dependencies;
+		TArray<uint8> DependencyModes;
+	};
+
+	static FString GetDefaultFilename();
+
+	// A missing, outdated or corrupt file just leaves the cache empty
+	void Load(const FString& Filename);
+	bool Save(const FString& Filename) const;
+
+	// Entries are only valid for the registry source and size types they were calculated with, switching either
+	// throws them away. Baselines are kept per size type, only switching the registry source throws them away.
+	void SetContext(const FString& InSourceName, const TArray<FName>& InSizeTypes);
+
+	const FPackageEntry* FindPackage(const FName& PackageName, const FIoHash& CurrentSavedHash) const;
+	void AddPackage(const FName& PackageName, FPackageEntry&& Entry);
+
+	const int64* FindBaseline(const FName& PackageName, const FName& SizeType) const;
+	void AddBaseline(const FName& PackageName, const FName& SizeType, int64 InitialSize);
+
+	// Drops the entries and baselines of the packages, so the file doesn't keep growing with deleted ones
+	void RemovePackages(TFunctionRef<bool(const FName& PackageName)> ShouldRemove);
+
+	const FString& GetSourceName() const { return SourceName; }
+	const TArray<FName>& GetSizeTypes() const { return SizeTypes; }
+
+private:
+	void Serialize(FArchive& Ar);
+
+	FString SourceName;
+	TArray<FName> SizeTypes;
+
+	TMap<FName, FPackageEntry> Packages;
+
+	// The size a package had the first time it was calculated, what the toolbar shows the difference against.
+	// Keyed by package and size type.
+	TMap<TPair<FName, FName>, int64> Baselines;
+};
@@ -0,0 +1,163 @@
+#include "BPSizeDominatorTree.h"
+
+FBPSizeDominatorTree::FBPSizeDominatorTree(const FBPSizeGraphSnapshot& Snapshot, int32 RootIndex, int32 SizeTypeIndex)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::BuildDominatorTree);
+
+	NodeOfPackage.Init(INDEX_NONE, Snapshot.GetNumPackages());
+	if (RootIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	auto isFollowed = [&Snapshot](int32 Edge)
+	{
+		return BPSizeDependencyModes::IsHardGame(Snapshot.DependencyModes[Edge]);
+	};
+
+	// Depth first with an explicit stack, closures of big blueprints are far deeper than the call stack allows
+	struct FFrame
+	{
+		int32 PackageIndex;
+		int32 NextEdge;
+	};
+
+	TBitArray<> visited(false, Snapshot.GetNumPackages());
+	TArray<int32> postorder;
+	TArray<FFrame> callStack;
+
+	auto discover = [&Snapshot, &visited, &callStack](int32 PackageIndex)
+	{
+		visited[PackageIndex] = true;
+
+		// Invalidated packages have no edges in the snapshot, unresolved ones have none to follow either
+		const int32 firstEdge = Snapshot.Resolved[PackageIndex] ? Snapshot.DependencyOffsets[PackageIndex] : Snapshot.DependencyOffsets[PackageIndex + 1];
+		callStack.Add({ PackageIndex, firstEdge });
+	};
+
+	discover(RootIndex);
+	while (!callStack.IsEmpty())
+	{
+		FFrame& frame = callStack.Last();
+		if (frame.NextEdge < Snapshot.DependencyOffsets[frame.PackageIndex + 1])
+		{
+			const int32 edge = frame.NextEdge++;
+			const int32 dependencyIndex = Snapshot.DependencyIndices[edge];
+			if (!visited[dependencyIndex] && isFollowed(edge))
+			{
+				discover(dependencyIndex);
+			}
+			continue;
+		}
+
+		postorder.Add(frame.PackageIndex);
+		callStack.Pop(false);
+	}
+
+	// Reverse postorder puts every node after at least one of its predecessors, and the root first
+	const int32 numNodes = postorder.Num();
+	Nodes.SetNum(numNodes);
+	for (int32 nodeId = 0; nodeId < numNodes; ++nodeId)
+	{
+		const int32 packageIndex = postorder[numNodes - 1 - nodeId];
+		Nodes[nodeId].PackageIndex = packageIndex;
+		NodeOfPackage[packageIndex] = nodeId;
+	}
+
+	// Predecessors of node i are predecessorIds[predecessorOffsets[i]] .. predecessorIds[predecessorOffsets[i + 1] - 1]
+	TArray<int32> predecessorOffsets;
+	predecessorOffsets.SetNumZeroed(numNodes + 1);
+	auto forEachSuccessor = [&Snapshot, &isFollowed, this](int32 NodeId, auto&& Visit)
+	{
+		const int32 packageIndex = Nodes[NodeId].PackageIndex;
+		if (!Snapshot.Resolved[packageIndex])
+		{
+			return;
+		}
+
+		for (int32 edge = Snapshot.DependencyOffsets[packageIndex]; edge < Snapshot.DependencyOffsets[packageIndex + 1]; ++edge)
+		{
+			if (isFollowed(edge))
+			{
+				Visit(NodeOfPackage[Snapshot.DependencyIndices[edge]]);
+			}
+		}
+	};
+
+	for (int32 nodeId = 0; nodeId < numNodes; ++nodeId)
+	{
+		forEachSuccessor(nodeId, [&predecessorOffsets](int32 SuccessorId) { ++predecessorOffsets[SuccessorId + 1]; });
+	}
+	for (int32 nodeId = 0; nodeId < numNodes; ++nodeId)
+	{
+		predecessorOffsets[nodeId + 1] += predecessorOffsets[nodeId];
+	}
+
+	TArray<int32> predecessorIds;
+	predecessorIds.SetNumUninitialized(predecessorOffsets[numNodes]);
+	TArray<int32> nextPredecessor(predecessorOffsets.GetData(), numNodes);
+	for (int32 nodeId = 0; nodeId < numNodes; ++nodeId)
+	{
+		forEachSuccessor(nodeId, [&predecessorIds, &nextPredecessor, nodeId](int32 SuccessorId) { predecessorIds[nextPredecessor[SuccessorId]++] = nodeId; });
+	}
+
+	// Both fingers climb the dominators found so far until they meet, a smaller id is always closer to the root
+	auto intersect = [this](int32 FirstId, int32 SecondId)
+	{
+		while (FirstId != SecondId)
+		{
+			while (FirstId > SecondId)
+			{
+				FirstId = Nodes[FirstId].ImmediateDominator;
+			}
+			while (SecondId > FirstId)
+			{
+				SecondId = Nodes[SecondId].ImmediateDominator;
+			}
+		}
+		return FirstId;
+	};
+
+	Nodes[RootNode].ImmediateDominator = RootNode;
+	for (bool changed = true; changed; ++NumPasses)
+	{
+		changed = false;
+		for (int32 nodeId = 1; nodeId < numNodes; ++nodeId)
+		{
+			int32 newDominator = INDEX_NONE;
+			for (int32 predecessor = predecessorOffsets[nodeId]; predecessor < predecessorOffsets[nodeId + 1]; ++predecessor)
+			{
+				const int32 predecessorId = predecessorIds[predecessor];
+				if (Nodes[predecessorId].ImmediateDominator != INDEX_NONE)
+				{
+					newDominator = newDominator == INDEX_NONE ? predecessorId : intersect(predecessorId, newDominator);
+				}
+			}
+
+			if (Nodes[nodeId].ImmediateDominator != newDominator)
+			{
+				Nodes[nodeId].ImmediateDominator = newDominator;
+				changed = true;
+			}
+		}
+	}
+
+	const TArray<int64>& selfSizes = Snapshot.SelfSizes[SizeTypeIndex];
+	const TBitArray<>& knownSizes = Snapshot.KnownSizes[SizeTypeIndex];
+	for (FNode& node : Nodes)
+	{
+		node.RetainedSize = selfSizes[node.PackageIndex];
+		node.NumRetainedPackages = 1;
+		node.HasKnownSize = knownSizes[node.PackageIndex];
+	}
+
+	// Dominators always come before the nodes they dominate, so going backwards finishes every subtree before its dominator
+	for (int32 nodeId = numNodes - 1; nodeId > RootNode; --nodeId)
+	{
+		const FNode& node = Nodes[nodeId];
+		FNode& dominator = Nodes[node.ImmediateDominator];
+		dominator.RetainedSize += node.RetainedSize;
+		dominator.NumRetainedPackages += node.NumRetainedPackages;
+		dominator.HasKnownSize &= node.HasKnownSize;
+	}
+}
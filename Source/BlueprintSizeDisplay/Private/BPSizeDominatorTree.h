@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BPSizeGraph.h"
+
+// Dominator tree of the closure of one package, along hard game references. A package dominates another one when
+// every path from the root to the other one goes through it, so its retained size is what would leave the closure
+// together with it: the package itself and everything only reachable through it. Unlike the *SHARED* node of the
+// SizeMap, this doesn't depend on the order the packages are found in.
+// Immediate dominators come from the iterative algorithm of Cooper, Harvey and Kennedy, over the reverse postorder
+// of the closure, which settles in a couple of passes on dependency graphs.
+class FBPSizeDominatorTree
+{
+public:
+	struct FNode
+	{
+		int32 PackageIndex = INDEX_NONE;
+
+		// Node id, always smaller than the id of the node itself. The root dominates itself.
+		int32 ImmediateDominator = INDEX_NONE;
+
+		int64 RetainedSize = 0;
+		int32 NumRetainedPackages = 0;
+		bool HasKnownSize = true;
+	};
+
+	static constexpr int32 RootNode = 0;
+
+	// Expects the closure of the root to be resolved in the snapshot, unresolved packages end up as leaves.
+	// Sized in one of the size types of the snapshot.
+	FBPSizeDominatorTree(const FBPSizeGraphSnapshot& Snapshot, int32 RootIndex, int32 SizeTypeIndex);
+
+	// Nodes are in reverse postorder of the closure, the root first
+	int32 GetNumNodes() const { return Nodes.Num(); }
+	const FNode& GetNode(int32 NodeId) const { return Nodes[NodeId]; }
+
+	// INDEX_NONE for packages outside the closure
+	int32 FindNode(int32 PackageIndex) const { return NodeOfPackage.IsValidIndex(PackageIndex) ? NodeOfPackage[PackageIndex] : INDEX_NONE; }
+
+	// Passes over the nodes until the immediate dominators stopped changing, the last one only confirms them
+	int32 GetNumPasses() const { return NumPasses; }
+
+private:
+	TArray<FNode> Nodes;
+	TArray<int32> NodeOfPackage;
+	int32 NumPasses = 0;
+};
@@ -0,0 +1,1214 @@
+#include "BPSizeGraph.h"
+
+#include "Async/ParallelFor.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "BPSizeCondensation.h"
+#include "BPSizeDiskCache.h"
+#include "BPSizeStats.h"
+
+namespace
+{
+	FIoHash GetPackageSavedHash(const FName& PackageName)
+	{
+		TOptional<FAssetPackageData> packageData = IAssetRegistry::GetChecked().GetAssetPackageDataCopy(PackageName);
+		return packageData.IsSet() ? packageData->GetPackageSavedHash() : FIoHash::Zero;
+	}
+
+	EBPSizeDependencyFlags GetDependencyFlags(UE::AssetRegistry::EDependencyProperty Properties)
+	{
+		using namespace UE::AssetRegistry;
+		EBPSizeDependencyFlags flags = EnumHasAnyFlags(Properties, EDependencyProperty::Hard) ? EBPSizeDependencyFlags::Hard : EBPSizeDependencyFlags::Soft;
+		flags |= EnumHasAnyFlags(Properties, EDependencyProperty::Game) ? EBPSizeDependencyFlags::Game : EBPSizeDependencyFlags::EditorOnly;
+		return flags;
+	}
+}
+
+FBPSizeGraph::FBPSizeGraph(IAssetManagerEditorModule& InEditorModule, const FAssetManagerEditorRegistrySource& InRegistrySource) :
+	EditorModule(InEditorModule),
+	RegistrySource(InRegistrySource),
+	SizeTypes({ IAssetManagerEditorModule::ResourceSizeName, IAssetManagerEditorModule::DiskSizeName }),
+	SizeProvider(InEditorModule, InRegistrySource)
+{
+	SelfSizes.SetNum(SizeTypes.Num());
+	KnownSizes.SetNum(SizeTypes.Num());
+}
+
+void FBPSizeGraph::Reset()
+{
+	++Generation;
+	CachedSnapshot.Reset();
+
+	PackageIndices.Empty();
+	PackageNames.Empty();
+	Resolved.Empty();
+	for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+	{
+		SelfSizes[sizeTypeIndex].Empty();
+		KnownSizes[sizeTypeIndex].Empty();
+	}
+	Dependencies.Empty();
+	DependencyModes.Empty();
+	SavedHashes.Empty();
+	Referencers.Empty();
+	ReferencersChanged.Empty();
+	NumReferencersChanged = 0;
+}
+
+int32 FBPSizeGraph::FindOrAddPackage(const FName& PackageName)
+{
+	if (const int32* existingIndex = PackageIndices.Find(PackageName))
+	{
+		return *existingIndex;
+	}
+
+	// Don't bother with code references, same as the SizeMap
+	if (PackageName == NAME_None || FBPSizePackageClassifier::IsScriptPackage(PackageName))
+	{
+		return INDEX_NONE;
+	}
+
+	CachedSnapshot.Reset();
+
+	const int32 packageIndex = PackageNames.Add(PackageName);
+	PackageIndices.Add(PackageName, packageIndex);
+	Resolved.Add(false);
+	for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+	{
+		SelfSizes[sizeTypeIndex].Add(0);
+		KnownSizes[sizeTypeIndex].Add(false);
+	}
+	Dependencies.AddDefaulted();
+	DependencyModes.AddDefaulted();
+	SavedHashes.AddDefaulted();
+	Referencers.AddDefaulted();
+	ReferencersChanged.Add(false);
+
+	return packageIndex;
+}
+
+void FBPSizeGraph::ResolvePackages(TConstArrayView<int32> Indices)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::ResolvePackages);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeResolve);
+
+	// Dependencies first, then the sizes of the whole frontier in one batch
+	TArray<int32> sizedIndices;
+	TArray<FAssetData> sizedAssets;
+	for (const int32 packageIndex : Indices)
+	{
+		if (Resolved[packageIndex])
+		{
+			continue;
+		}
+
+		FAssetData assetData;
+		if (ResolvePackageDependencies(packageIndex, assetData))
+		{
+			sizedIndices.Add(packageIndex);
+			sizedAssets.Add(MoveTemp(assetData));
+		}
+	}
+
+	ResolveSelfSizes(sizedIndices, sizedAssets);
+}
+
+void FBPSizeGraph::ResolvePackage(int32 PackageIndex)
+{
+	FAssetData assetData;
+	if (ResolvePackageDependencies(PackageIndex, assetData))
+	{
+		ResolveSelfSizes(MakeArrayView(&PackageIndex, 1), MakeArrayView(&assetData, 1));
+	}
+}
+
+void FBPSizeGraph::ResolveSelfSizes(TConstArrayView<int32> Indices, TConstArrayView<FAssetData> Assets)
+{
+	// Every size type while the frontier is at hand, so asking for another one later doesn't walk again
+	for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+	{
+		const FName& sizeType = SizeTypes[sizeTypeIndex];
+		SizeProvider.Prefetch(Assets, sizeType);
+
+		for (int32 packageOrdinal = 0; packageOrdinal < Indices.Num(); ++packageOrdinal)
+		{
+			int64 foundSize = 0;
+			if (SizeProvider.GetSize(Assets[packageOrdinal], sizeType, foundSize))
+			{
+				// If we're reading cooked data, this will fail for dependencies that are editor only. This is fine, they will have 0 size
+				SelfSizes[sizeTypeIndex][Indices[packageOrdinal]] = foundSize;
+				KnownSizes[sizeTypeIndex][Indices[packageOrdinal]] = true;
+			}
+		}
+	}
+}
+
+bool FBPSizeGraph::ResolvePackageDependencies(int32 PackageIndex, FAssetData& OutAssetData)
+{
+	CachedSnapshot.Reset();
+
+	Resolved[PackageIndex] = true;
+	for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+	{
+		SelfSizes[sizeTypeIndex][PackageIndex] = 0;
+		KnownSizes[sizeTypeIndex][PackageIndex] = false;
+	}
+	SavedHashes[PackageIndex] = GetPackageSavedHash(PackageNames[PackageIndex]);
+
+	if (ResolvePackageFromDiskCache(PackageIndex))
+	{
+		return false;
+	}
+
+	const FName packageName = PackageNames[PackageIndex];
+	OutAssetData = RegistrySource.GetAssetByObjectPath(FBPSizePackageClassifier::MakeMainAssetPath(packageName));
+
+	if (!OutAssetData.IsValid())
+	{
+		// The SizeMap counts these as assets which failed to load, they leave the size unknown
+		SetDependencies(PackageIndex, {}, {});
+		return false;
+	}
+
+	// Every package reference at once, with its properties, so each dependency mode is walked off the same edges
+	FAssetManagerDependencyQuery dependencyQuery = FAssetManagerDependencyQuery::None();
+	dependencyQuery.Categories = UE::AssetRegistry::EDependencyCategory::Package;
+
+	TArray<FAssetDependency> dependencies;
+	if (const FAssetRegistryState* registryState = RegistrySource.GetOwnedRegistryState())
+	{
+		registryState->GetDependencies(FAssetIdentifier(packageName), dependencies, dependencyQuery.Categories);
+	}
+	else
+	{
+		IAssetRegistry::GetChecked().GetDependencies(FAssetIdentifier(packageName), dependencies, dependencyQuery.Categories);
+	}
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::DependencyQueries);
+
+	// The filter may swap a reference for the ones standing in for it in the cook, so each kind of reference is
+	// filtered on its own and the substitutes keep the flags of what they replace. There are only four kinds.
+	TMap<EBPSizeDependencyFlags, TArray<FAssetIdentifier>> referencesByFlags;
+	for (const FAssetDependency& dependency : dependencies)
+	{
+		referencesByFlags.FindOrAdd(GetDependencyFlags(dependency.Properties)).Add(dependency.AssetId);
+	}
+
+	TArray<int32> dependencyIndices;
+	TArray<uint8> dependencyModes;
+	TMap<int32, int32> dependencyOrdinals;
+	dependencyIndices.Reserve(dependencies.Num());
+	dependencyModes.Reserve(dependencies.Num());
+	dependencyOrdinals.Reserve(dependencies.Num());
+	for (TPair<EBPSizeDependencyFlags, TArray<FAssetIdentifier>>& flaggedReferences : referencesByFlags)
+	{
+		const EBPSizeDependencyFlags flags = flaggedReferences.Key;
+		TArray<FAssetIdentifier>& references = flaggedReferences.Value;
+
+		using namespace UE::AssetRegistry;
+		dependencyQuery.Flags = EnumHasAnyFlags(flags, EBPSizeDependencyFlags::Hard) ? EDependencyQuery::Hard : EDependencyQuery::Soft;
+		dependencyQuery.Flags |= EnumHasAnyFlags(flags, EBPSizeDependencyFlags::Game) ? EDependencyQuery::Game : EDependencyQuery::EditorOnly;
+		EditorModule.FilterAssetIdentifiersForCurrentRegistrySource(references, dependencyQuery, true);
+
+		for (const FAssetIdentifier& reference : references)
+		{
+			if (!reference.IsPackage())
+			{
+				continue;
+			}
+
+			const int32 dependencyIndex = FindOrAddPackage(reference.PackageName);
+			if (dependencyIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			// A package referenced several ways keeps one edge with the modes following any of its references,
+			// merging the flags instead would make an editor-only hard plus a soft game reference look hard game
+			const uint8 modes = BPSizeDependencyModes::GetFollowingModes(flags);
+			if (const int32* existingOrdinal = dependencyOrdinals.Find(dependencyIndex))
+			{
+				dependencyModes[*existingOrdinal] |= modes;
+			}
+			else
+			{
+				dependencyOrdinals.Add(dependencyIndex, dependencyIndices.Num());
+				dependencyIndices.Add(dependencyIndex);
+				dependencyModes.Add(modes);
+			}
+		}
+	}
+	SetDependencies(PackageIndex, MoveTemp(dependencyIndices), MoveTemp(dependencyModes));
+
+	return true;
+}
+
+bool FBPSizeGraph::ResolvePackageFromDiskCache(int32 PackageIndex)
+{
+	if (!DiskCache || DiskCache->GetSizeTypes() != SizeTypes || DiskCache->GetSourceName() != RegistrySource.SourceName)
+	{
+		return false;
+	}
+
+	const FBPSizeDiskCache::FPackageEntry* entry = DiskCache->FindPackage(PackageNames[PackageIndex], SavedHashes[PackageIndex]);
+	if (!entry)
+	{
+		return false;
+	}
+
+	TArray<int32> dependencyIndices;
+	TArray<uint8> dependencyModes;
+	dependencyIndices.Reserve(entry->Dependencies.Num());
+	dependencyModes.Reserve(entry->Dependencies.Num());
+	for (int32 dependencyOrdinal = 0; dependencyOrdinal < entry->Dependencies.Num(); ++dependencyOrdinal)
+	{
+		const int32 dependencyIndex = FindOrAddPackage(entry->Dependencies[dependencyOrdinal]);
+		if (dependencyIndex != INDEX_NONE)
+		{
+			dependencyIndices.Add(dependencyIndex);
+			dependencyModes.Add(entry->DependencyModes[dependencyOrdinal]);
+		}
+	}
+	SetDependencies(PackageIndex, MoveTemp(dependencyIndices), MoveTemp(dependencyModes));
+
+	for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+	{
+		SelfSizes[sizeTypeIndex][PackageIndex] = entry->SelfSizes[sizeTypeIndex];
+		KnownSizes[sizeTypeIndex][PackageIndex] = entry->KnownSizes[sizeTypeIndex];
+	}
+
+	return true;
+}
+
+void FBPSizeGraph::ExportToDiskCache(FBPSizeDiskCache& OutDiskCache) const
+{
+	OutDiskCache.SetContext(RegistrySource.SourceName, SizeTypes);
+
+	for (int32 packageIndex = 0; packageIndex < PackageNames.Num(); ++packageIndex)
+	{
+		// Without a saved hash there is no telling later whether the entry is still valid
+		if (!Resolved[packageIndex] || SavedHashes[packageIndex].IsZero())
+		{
+			continue;
+		}
+
+		FBPSizeDiskCache::FPackageEntry entry;
+		entry.SavedHash = SavedHashes[packageIndex];
+		entry.SelfSizes.Reserve(SizeTypes.Num());
+		entry.KnownSizes.Reserve(SizeTypes.Num());
+		for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+		{
+			entry.SelfSizes.Add(SelfSizes[sizeTypeIndex][packageIndex]);
+			entry.KnownSizes.Add(KnownSizes[sizeTypeIndex][packageIndex]);
+		}
+		entry.Dependencies.Reserve(Dependencies[packageIndex].Num());
+		for (const int32 dependencyIndex : Dependencies[packageIndex])
+		{
+			entry.Dependencies.Add(PackageNames[dependencyIndex]);
+		}
+		entry.DependencyModes = DependencyModes[packageIndex];
+
+		OutDiskCache.AddPackage(PackageNames[packageIndex], MoveTemp(entry));
+	}
+}
+
+void FBPSizeGraph::SetDependencies(int32 PackageIndex, TArray<int32>&& NewDependencies, TArray<uint8>&& NewDependencyModes)
+{
+	check(NewDependencies.Num() == NewDependencyModes.Num());
+
+	auto markChanged = [this](int32 DependencyIndex)
+	{
+		if (!ReferencersChanged[DependencyIndex])
+		{
+			ReferencersChanged[DependencyIndex] = true;
+			++NumReferencersChanged;
+		}
+	};
+
+	for (const int32 oldDependency : Dependencies[PackageIndex])
+	{
+		Referencers[oldDependency].RemoveSingleSwap(PackageIndex, false);
+		markChanged(oldDependency);
+	}
+
+	Dependencies[PackageIndex] = MoveTemp(NewDependencies);
+	DependencyModes[PackageIndex] = MoveTemp(NewDependencyModes);
+
+	for (const int32 newDependency : Dependencies[PackageIndex])
+	{
+		Referencers[newDependency].Add(PackageIndex);
+		markChanged(newDependency);
+	}
+}
+
+void FBPSizeGraph::ConsumeReferencerChanges(TArray<int32>& OutPackageIndices)
+{
+	if (NumReferencersChanged == 0)
+	{
+		return;
+	}
+
+	OutPackageIndices.Reserve(OutPackageIndices.Num() + NumReferencersChanged);
+	for (TConstSetBitIterator<> changed(ReferencersChanged); changed; ++changed)
+	{
+		OutPackageIndices.Add(changed.GetIndex());
+	}
+
+	ReferencersChanged.Init(false, ReferencersChanged.Num());
+	NumReferencersChanged = 0;
+}
+
+bool FBPSizeGraph::IsHardGameDependency(int32 ReferencerIndex, int32 DependencyIndex) const
+{
+	const int32 dependencyOrdinal = Dependencies[ReferencerIndex].Find(DependencyIndex);
+	return dependencyOrdinal != INDEX_NONE && BPSizeDependencyModes::IsHardGame(DependencyModes[ReferencerIndex][dependencyOrdinal]);
+}
+
+void FBPSizeGraph::InvalidatePackage(const FName& PackageName, TArray<FName>& OutAffectedPackages)
+{
+	SizeProvider.InvalidatePackage(PackageName);
+
+	const int32* foundIndex = PackageIndices.Find(PackageName);
+	if (!foundIndex)
+	{
+		// Nothing we know of depends on it
+		return;
+	}
+
+	const int32 changedIndex = *foundIndex;
+	if (Resolved[changedIndex])
+	{
+		// Resaving often changes neither the size nor the references, in that case no closure is affected
+		const TArray<int32> oldDependencies = Dependencies[changedIndex];
+		const TArray<uint8> oldDependencyModes = DependencyModes[changedIndex];
+		FBPSizeTypeSizes oldSelfSizes;
+		FBPSizeTypeFlags oldKnownSizes;
+		for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+		{
+			oldSelfSizes.Add(SelfSizes[sizeTypeIndex][changedIndex]);
+			oldKnownSizes.Add(KnownSizes[sizeTypeIndex][changedIndex]);
+		}
+
+		ResolvePackage(changedIndex);
+
+		bool isUnchanged = Dependencies[changedIndex] == oldDependencies && DependencyModes[changedIndex] == oldDependencyModes;
+		for (int32 sizeTypeIndex = 0; isUnchanged && sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+		{
+			isUnchanged = SelfSizes[sizeTypeIndex][changedIndex] == oldSelfSizes[sizeTypeIndex]
+				&& KnownSizes[sizeTypeIndex][changedIndex] == oldKnownSizes[sizeTypeIndex];
+		}
+		if (isUnchanged)
+		{
+			return;
+		}
+	}
+
+	TBitArray<> visited(false, PackageNames.Num());
+	TArray<int32> stack;
+
+	visited[changedIndex] = true;
+	stack.Add(changedIndex);
+
+	while (!stack.IsEmpty())
+	{
+		const int32 packageIndex = stack.Pop(false);
+		OutAffectedPackages.Add(PackageNames[packageIndex]);
+
+		for (const int32 referencerIndex : Referencers[packageIndex])
+		{
+			if (!visited[referencerIndex])
+			{
+				visited[referencerIndex] = true;
+				stack.Add(referencerIndex);
+			}
+		}
+	}
+}
+
+void FBPSizeGraph::AttributeClosureChange(TConstArrayView<uint64> OldClosureWords, TConstArrayView<uint64> NewClosureWords, int32 SizeTypeIndex, FBPSizeClosureChange& OutChange) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::AttributeClosureChange);
+
+	OutChange = FBPSizeClosureChange();
+	const TArray<int64>& selfSizes = SelfSizes[SizeTypeIndex];
+
+	// The closures may have been taken when the graph had fewer packages, the missing words are empty
+	const int32 numWords = FMath::DivideAndRoundUp(PackageNames.Num(), 64);
+	auto getWord = [](TConstArrayView<uint64> Words, int32 WordIndex)
+	{
+		return Words.IsValidIndex(WordIndex) ? Words[WordIndex] : 0ull;
+	};
+
+	TArray<uint64> addedWords;
+	addedWords.SetNumUninitialized(numWords);
+	TArray<int32> addedPackages;
+	for (int32 wordIndex = 0; wordIndex < numWords; ++wordIndex)
+	{
+		const uint64 oldWord = getWord(OldClosureWords, wordIndex);
+		const uint64 newWord = getWord(NewClosureWords, wordIndex);
+		addedWords[wordIndex] = newWord & ~oldWord;
+
+		for (uint64 addedWord = addedWords[wordIndex]; addedWord != 0; addedWord &= addedWord - 1)
+		{
+			addedPackages.Add(wordIndex * 64 + FMath::CountTrailingZeros64(addedWord));
+		}
+
+		for (uint64 removedWord = oldWord & ~newWord; removedWord != 0; removedWord &= removedWord - 1)
+		{
+			const int32 packageIndex = wordIndex * 64 + FMath::CountTrailingZeros64(removedWord);
+			OutChange.RemovedSize += selfSizes[packageIndex];
+			OutChange.RemovedPackages.Add({ PackageNames[packageIndex], selfSizes[packageIndex] });
+		}
+	}
+
+	auto isAdded = [&addedWords](int32 PackageIndex)
+	{
+		return (addedWords[PackageIndex >> 6] & (1ull << (PackageIndex & 63))) != 0;
+	};
+
+	for (const int32 packageIndex : addedPackages)
+	{
+		OutChange.AddedSize += selfSizes[packageIndex];
+	}
+	OutChange.NumAddedPackages = addedPackages.Num();
+
+	// Every added package with a referencer that was there before is where an added subgraph starts.
+	// Its contribution is what it reaches without leaving the added packages.
+	TBitArray<> visited(false, PackageNames.Num());
+	TArray<int32> visitedPackages;
+	TArray<int32> stack;
+	for (const int32 entryIndex : addedPackages)
+	{
+		int64 entrySize = 0;
+		int32 numEntryPackages = 0;
+		bool isEntrySized = false;
+
+		for (const int32 referencerIndex : Referencers[entryIndex])
+		{
+			const bool isInNewClosure = (getWord(NewClosureWords, referencerIndex >> 6) & (1ull << (referencerIndex & 63))) != 0;
+			if (!isInNewClosure || isAdded(referencerIndex) || !IsHardGameDependency(referencerIndex, entryIndex))
+			{
+				continue;
+			}
+
+			if (!isEntrySized)
+			{
+				visited[entryIndex] = true;
+				visitedPackages.Add(entryIndex);
+				stack.Add(entryIndex);
+
+				while (!stack.IsEmpty())
+				{
+					const int32 packageIndex = stack.Pop(false);
+					entrySize += selfSizes[packageIndex];
+					++numEntryPackages;
+
+					for (int32 dependencyOrdinal = 0; dependencyOrdinal < Dependencies[packageIndex].Num(); ++dependencyOrdinal)
+					{
+						const int32 dependencyIndex = Dependencies[packageIndex][dependencyOrdinal];
+						if (isAdded(dependencyIndex) && !visited[dependencyIndex] && BPSizeDependencyModes::IsHardGame(DependencyModes[packageIndex][dependencyOrdinal]))
+						{
+							visited[dependencyIndex] = true;
+							visitedPackages.Add(dependencyIndex);
+							stack.Add(dependencyIndex);
+						}
+					}
+				}
+
+				for (const int32 visitedIndex : visitedPackages)
+				{
+					visited[visitedIndex] = false;
+				}
+				visitedPackages.Reset();
+				isEntrySized = true;
+			}
+
+			FBPSizeEdgeContribution& edge = OutChange.AddedEdges.AddDefaulted_GetRef();
+			edge.ReferencerName = PackageNames[referencerIndex];
+			edge.DependencyName = PackageNames[entryIndex];
+			edge.Size = entrySize;
+			edge.NumPackages = numEntryPackages;
+		}
+	}
+
+	OutChange.AddedEdges.Sort([](const FBPSizeEdgeContribution& A, const FBPSizeEdgeContribution& B) { return A.Size > B.Size; });
+	OutChange.RemovedPackages.Sort([](const FBPSizePackageSize& A, const FBPSizePackageSize& B) { return A.Size > B.Size; });
+}
+
+int32 FBPSizeGraph::FindOrAddSizeType(const FName& SizeTypeToCalculate)
+{
+	const int32 existingIndex = SizeTypes.Find(SizeTypeToCalculate);
+	if (existingIndex != INDEX_NONE)
+	{
+		return existingIndex;
+	}
+
+	// The memoized packages have no sizes of the new type, and would never be resolved again to get them
+	Reset();
+	SelfSizes.AddDefaulted();
+	KnownSizes.AddDefaulted();
+	return SizeTypes.Add(SizeTypeToCalculate);
+}
+
+TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> FBPSizeGraph::GetSnapshot()
+{
+	if (CachedSnapshot.IsValid())
+	{
+		return CachedSnapshot.ToSharedRef();
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::GetSnapshot);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeSnapshot);
+
+	TSharedRef<FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = MakeShared<FBPSizeGraphSnapshot, ESPMode::ThreadSafe>();
+	snapshot->Generation = Generation;
+	snapshot->Resolved = Resolved;
+	snapshot->SizeTypes = SizeTypes;
+	snapshot->SelfSizes = SelfSizes;
+	snapshot->KnownSizes = KnownSizes;
+
+	snapshot->DependencyOffsets.Reserve(PackageNames.Num() + 1);
+	for (int32 packageIndex = 0; packageIndex < PackageNames.Num(); ++packageIndex)
+	{
+		snapshot->DependencyOffsets.Add(snapshot->DependencyIndices.Num());
+
+		// Invalidated packages still have their old edges, those must not be followed
+		if (Resolved[packageIndex])
+		{
+			snapshot->DependencyIndices.Append(Dependencies[packageIndex]);
+			snapshot->DependencyModes.Append(DependencyModes[packageIndex]);
+		}
+	}
+	snapshot->DependencyOffsets.Add(snapshot->DependencyIndices.Num());
+
+	SIZE_T numSizeBytes = 0;
+	for (const TArray<int64>& selfSizes : snapshot->SelfSizes)
+	{
+		numSizeBytes += selfSizes.GetAllocatedSize();
+	}
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::BytesAllocated,
+		snapshot->DependencyOffsets.GetAllocatedSize() + snapshot->DependencyIndices.GetAllocatedSize() + snapshot->DependencyModes.GetAllocatedSize() + numSizeBytes);
+
+	CachedSnapshot = snapshot;
+	return snapshot;
+}
+
+void FBPSizeGraph::CalculateClosureSizes(TConstArrayView<FName> RootPackageNames, FBPSizeBatchResult& OutResult)
+{
+	TArray<int32> rootIndices;
+	rootIndices.Reserve(RootPackageNames.Num());
+	for (const FName& rootPackageName : RootPackageNames)
+	{
+		rootIndices.Add(FindOrAddPackage(rootPackageName));
+	}
+
+	// Resolve the union of all closures first, walking it once per round instead of once per root
+	FBPSizeClosureResult unionResult = GetSnapshot()->CalculateUnionClosure(rootIndices);
+	while (!unionResult.UnresolvedPackages.IsEmpty())
+	{
+		ResolvePackages(unionResult.UnresolvedPackages);
+		unionResult = GetSnapshot()->CalculateUnionClosure(rootIndices);
+	}
+
+	OutResult = GetSnapshot()->CalculateClosures(rootIndices);
+}
+
+void FBPSizeGraph::CalculateClosureSize(const FName& RootPackageName, FBPSizeClosureResult& OutResult)
+{
+	const int32 rootIndex = FindOrAddPackage(RootPackageName);
+
+	// Every round resolves the packages the previous walk could not get past
+	OutResult = GetSnapshot()->CalculateClosure(rootIndex);
+	while (!OutResult.UnresolvedPackages.IsEmpty())
+	{
+		ResolvePackages(OutResult.UnresolvedPackages);
+		OutResult = GetSnapshot()->CalculateClosure(rootIndex);
+	}
+}
+
+void FBPSizeGraph::GatherClosurePackages(const FName& RootPackageName, TArray<FName>& OutPackageNames)
+{
+	const int32 rootIndex = FindOrAddPackage(RootPackageName);
+	if (rootIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	TBitArray<> visited;
+	TArray<int32> closurePackages;
+	WalkClosure(MakeArrayView(&rootIndex, 1), visited, closurePackages);
+
+	OutPackageNames.Reserve(OutPackageNames.Num() + closurePackages.Num());
+	for (const int32 packageIndex : closurePackages)
+	{
+		OutPackageNames.Add(PackageNames[packageIndex]);
+	}
+}
+
+void FBPSizeGraph::WalkClosure(TConstArrayView<int32> RootIndices, TBitArray<>& InOutVisited, TArray<int32>& OutReached)
+{
+	InOutVisited.Add(false, PackageNames.Num() - InOutVisited.Num());
+
+	TArray<int32> frontier;
+	TArray<int32> nextFrontier;
+	for (const int32 rootIndex : RootIndices)
+	{
+		if (!InOutVisited[rootIndex])
+		{
+			InOutVisited[rootIndex] = true;
+			frontier.Add(rootIndex);
+		}
+	}
+
+	while (!frontier.IsEmpty())
+	{
+		ResolvePackages(frontier);
+		InOutVisited.Add(false, PackageNames.Num() - InOutVisited.Num());
+
+		for (const int32 packageIndex : frontier)
+		{
+			OutReached.Add(packageIndex);
+
+			for (int32 dependencyOrdinal = 0; dependencyOrdinal < Dependencies[packageIndex].Num(); ++dependencyOrdinal)
+			{
+				const int32 dependencyIndex = Dependencies[packageIndex][dependencyOrdinal];
+				if (!InOutVisited[dependencyIndex] && BPSizeDependencyModes::IsHardGame(DependencyModes[packageIndex][dependencyOrdinal]))
+				{
+					InOutVisited[dependencyIndex] = true;
+					nextFrontier.Add(dependencyIndex);
+				}
+			}
+		}
+
+		Swap(frontier, nextFrontier);
+		nextFrontier.Reset();
+	}
+}
+
+void FBPSizeGraph::EstimateClosureSize(const FName& RootPackageName, TConstArrayView<FName> NewDependencyNames, FBPSizeClosureEstimate& OutEstimate)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::EstimateClosureSize);
+
+	OutEstimate = FBPSizeClosureEstimate();
+	OutEstimate.SavedSizes.Init(0, SizeTypes.Num());
+	OutEstimate.HasKnownSizes.Init(true, SizeTypes.Num());
+
+	const int32 rootIndex = FindOrAddPackage(RootPackageName);
+	if (rootIndex == INDEX_NONE)
+	{
+		OutEstimate.EstimatedSizes = OutEstimate.SavedSizes;
+		return;
+	}
+
+	auto addPackages = [this, &OutEstimate](TConstArrayView<int32> Indices, FBPSizeTypeSizes& InOutSizes)
+	{
+		for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+		{
+			for (const int32 packageIndex : Indices)
+			{
+				InOutSizes[sizeTypeIndex] += SelfSizes[sizeTypeIndex][packageIndex];
+				OutEstimate.HasKnownSizes[sizeTypeIndex] &= KnownSizes[sizeTypeIndex][packageIndex];
+			}
+		}
+	};
+
+	// Memoized by the calculations of the saved size, so this normally doesn't query the registry at all
+	TBitArray<> savedClosure;
+	TArray<int32> savedPackages;
+	WalkClosure(MakeArrayView(&rootIndex, 1), savedClosure, savedPackages);
+
+	addPackages(savedPackages, OutEstimate.SavedSizes);
+	OutEstimate.EstimatedSizes = OutEstimate.SavedSizes;
+
+	TArray<int32> newDependencies;
+	for (const FName& dependencyName : NewDependencyNames)
+	{
+		const int32 dependencyIndex = FindOrAddPackage(dependencyName);
+		if (dependencyIndex != INDEX_NONE && dependencyIndex != rootIndex)
+		{
+			newDependencies.AddUnique(dependencyIndex);
+		}
+	}
+
+	// The compiled references are the hard game ones, so they replace just the hard game edges of the saved package
+	TArray<int32> oldDependencies;
+	for (int32 dependencyOrdinal = 0; dependencyOrdinal < Dependencies[rootIndex].Num(); ++dependencyOrdinal)
+	{
+		if (BPSizeDependencyModes::IsHardGame(DependencyModes[rootIndex][dependencyOrdinal]))
+		{
+			oldDependencies.Add(Dependencies[rootIndex][dependencyOrdinal]);
+		}
+	}
+
+	TArray<int32> addedDependencies;
+	TArray<int32> removedDependencies;
+	for (const int32 dependencyIndex : newDependencies)
+	{
+		if (!oldDependencies.Contains(dependencyIndex))
+		{
+			addedDependencies.Add(dependencyIndex);
+		}
+	}
+	for (const int32 dependencyIndex : oldDependencies)
+	{
+		if (!newDependencies.Contains(dependencyIndex))
+		{
+			removedDependencies.Add(dependencyIndex);
+		}
+	}
+
+	OutEstimate.NumAddedDependencies = addedDependencies.Num();
+	OutEstimate.NumRemovedDependencies = removedDependencies.Num();
+
+	// Whatever the added dependencies reach outside the saved closure is new, the walk stops at the saved packages
+	TBitArray<> extendedClosure = savedClosure;
+	TArray<int32> addedPackages;
+	WalkClosure(addedDependencies, extendedClosure, addedPackages);
+	savedClosure.Add(false, PackageNames.Num() - savedClosure.Num());
+
+	addPackages(addedPackages, OutEstimate.EstimatedSizes);
+	OutEstimate.NumAddedPackages = addedPackages.Num();
+
+	// Only what the removed dependencies reach can drop out, the rest is still reached through the other dependencies
+	TBitArray<> candidates(false, PackageNames.Num());
+	TArray<int32> candidatePackages;
+	TArray<int32> stack;
+	for (const int32 dependencyIndex : removedDependencies)
+	{
+		candidates[dependencyIndex] = true;
+		stack.Add(dependencyIndex);
+	}
+
+	while (!stack.IsEmpty())
+	{
+		const int32 packageIndex = stack.Pop(false);
+		candidatePackages.Add(packageIndex);
+
+		for (int32 dependencyOrdinal = 0; dependencyOrdinal < Dependencies[packageIndex].Num(); ++dependencyOrdinal)
+		{
+			const int32 dependencyIndex = Dependencies[packageIndex][dependencyOrdinal];
+			if (dependencyIndex != rootIndex && !candidates[dependencyIndex] && BPSizeDependencyModes::IsHardGame(DependencyModes[packageIndex][dependencyOrdinal]))
+			{
+				candidates[dependencyIndex] = true;
+				stack.Add(dependencyIndex);
+			}
+		}
+	}
+
+	// A candidate stays when the root still depends on it directly, or a package outside the candidates does.
+	// The edges of the root itself are the new ones, so it doesn't count as a referencer.
+	TBitArray<> keptCandidates(false, PackageNames.Num());
+	for (const int32 packageIndex : candidatePackages)
+	{
+		bool isKept = newDependencies.Contains(packageIndex);
+		for (int32 referencerOrdinal = 0; !isKept && referencerOrdinal < Referencers[packageIndex].Num(); ++referencerOrdinal)
+		{
+			const int32 referencerIndex = Referencers[packageIndex][referencerOrdinal];
+			isKept = referencerIndex != rootIndex && extendedClosure[referencerIndex] && !candidates[referencerIndex]
+				&& IsHardGameDependency(referencerIndex, packageIndex);
+		}
+
+		if (isKept)
+		{
+			keptCandidates[packageIndex] = true;
+			stack.Add(packageIndex);
+		}
+	}
+
+	while (!stack.IsEmpty())
+	{
+		const int32 packageIndex = stack.Pop(false);
+		for (int32 dependencyOrdinal = 0; dependencyOrdinal < Dependencies[packageIndex].Num(); ++dependencyOrdinal)
+		{
+			const int32 dependencyIndex = Dependencies[packageIndex][dependencyOrdinal];
+			if (candidates[dependencyIndex] && !keptCandidates[dependencyIndex] && BPSizeDependencyModes::IsHardGame(DependencyModes[packageIndex][dependencyOrdinal]))
+			{
+				keptCandidates[dependencyIndex] = true;
+				stack.Add(dependencyIndex);
+			}
+		}
+	}
+
+	for (const int32 packageIndex : candidatePackages)
+	{
+		if (!keptCandidates[packageIndex])
+		{
+			for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+			{
+				OutEstimate.EstimatedSizes[sizeTypeIndex] -= SelfSizes[sizeTypeIndex][packageIndex];
+			}
+			++OutEstimate.NumRemovedPackages;
+		}
+	}
+}
+
+FBPSizeClosureResult FBPSizeGraphSnapshot::CalculateClosure(int32 RootIndex, const std::atomic<bool>* Cancelled, int32 NumThreads, uint8 Modes) const
+{
+	return CalculateUnionClosure(MakeArrayView(&RootIndex, 1), Cancelled, NumThreads, Modes);
+}
+
+FBPSizeClosureResult FBPSizeGraphSnapshot::CalculateUnionClosure(TConstArrayView<int32> RootIndices, const std::atomic<bool>* Cancelled, int32 NumThreads, uint8 Modes) const
+{
+	if (NumThreads > 1 && Modes == BPSizeDependencyModes::HardGame)
+	{
+		return CalculateClosureParallel(RootIndices, Cancelled, NumThreads);
+	}
+
+	return CalculateClosureSerial(RootIndices, Cancelled, Modes | BPSizeDependencyModes::HardGame);
+}
+
+FBPSizeClosureResult FBPSizeGraphSnapshot::CalculateClosureSerial(TConstArrayView<int32> RootIndices, const std::atomic<bool>* Cancelled, uint8 Modes) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::CalculateClosureSerial);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeClosureWalk);
+
+	constexpr int32 NumModes = static_cast<int32>(EBPSizeDependencyMode::Num);
+	const int32 hardGameMode = static_cast<int32>(EBPSizeDependencyMode::HardGame);
+
+	FBPSizeClosureResult result;
+	FBPSizeModeClosure modeClosures[NumModes];
+	for (FBPSizeModeClosure& modeClosure : modeClosures)
+	{
+		modeClosure.Sizes.Init(0, SizeTypes.Num());
+		modeClosure.HasKnownSizes.Init(true, SizeTypes.Num());
+	}
+
+	// A package is walked once per mode reaching it, the stack holds the modes it was newly reached in
+	TArray<uint8> reachedModes;
+	reachedModes.SetNumZeroed(GetNumPackages());
+	TArray<TPair<int32, uint8>> stack;
+	auto reach = [this, &reachedModes, &stack, &result](int32 PackageIndex, uint8 PackageModes)
+	{
+		const uint8 newModes = PackageModes & ~reachedModes[PackageIndex];
+		if (newModes == 0)
+		{
+			return;
+		}
+
+		if (reachedModes[PackageIndex] == 0 && !Resolved[PackageIndex])
+		{
+			result.UnresolvedPackages.Add(PackageIndex);
+		}
+		reachedModes[PackageIndex] |= newModes;
+		stack.Emplace(PackageIndex, newModes);
+	};
+
+	for (const int32 rootIndex : RootIndices)
+	{
+		if (rootIndex != INDEX_NONE)
+		{
+			reach(rootIndex, Modes);
+		}
+	}
+
+	int32 numVisits = 0;
+	while (!stack.IsEmpty())
+	{
+		// Checking every node would be wasteful, the flag only needs to be noticed eventually
+		if (Cancelled && (numVisits & 1023) == 0 && Cancelled->load(std::memory_order_relaxed))
+		{
+			result.WasCancelled = true;
+			return result;
+		}
+
+		const TPair<int32, uint8> entry = stack.Pop(false);
+		const int32 packageIndex = entry.Key;
+		++numVisits;
+
+		for (int32 mode = 0; mode < NumModes; ++mode)
+		{
+			if ((entry.Value & (1 << mode)) == 0)
+			{
+				continue;
+			}
+
+			FBPSizeModeClosure& modeClosure = modeClosures[mode];
+			++modeClosure.NumPackages;
+			for (int32 sizeTypeIndex = 0; Resolved[packageIndex] && sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+			{
+				modeClosure.Sizes[sizeTypeIndex] += SelfSizes[sizeTypeIndex][packageIndex];
+				modeClosure.HasKnownSizes[sizeTypeIndex] &= KnownSizes[sizeTypeIndex][packageIndex];
+			}
+		}
+
+		if (!Resolved[packageIndex])
+		{
+			continue;
+		}
+
+		for (int32 edge = DependencyOffsets[packageIndex]; edge < DependencyOffsets[packageIndex + 1]; ++edge)
+		{
+			const uint8 followingModes = entry.Value & DependencyModes[edge];
+			if (followingModes != 0)
+			{
+				reach(DependencyIndices[edge], followingModes);
+			}
+		}
+	}
+
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::NodesVisited, numVisits);
+
+	result.Sizes = modeClosures[hardGameMode].Sizes;
+	result.HasKnownSizes = modeClosures[hardGameMode].HasKnownSizes;
+	result.NumPackages = modeClosures[hardGameMode].NumPackages;
+	if (Modes != BPSizeDependencyModes::HardGame)
+	{
+		result.ModeClosures.Append(modeClosures, NumModes);
+	}
+
+	TBitArray<> inClosure(false, GetNumPackages());
+	for (int32 packageIndex = 0; packageIndex < GetNumPackages(); ++packageIndex)
+	{
+		inClosure[packageIndex] = (reachedModes[packageIndex] & BPSizeDependencyModes::HardGame) != 0;
+	}
+	FBPSizeCondensation::ToWords(inClosure, result.ClosureWords);
+
+	return result;
+}
+
+FBPSizeClosureResult FBPSizeGraphSnapshot::CalculateClosureParallel(TConstArrayView<int32> RootIndices, const std::atomic<bool>* Cancelled, int32 NumThreads) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::CalculateClosureParallel);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeClosureWalk);
+
+	FBPSizeClosureResult result;
+	result.InitSizes(SizeTypes.Num());
+
+	// Small frontiers are not worth handing out to other threads
+	constexpr int32 MinPackagesPerChunk = 256;
+
+	struct FChunkResult
+	{
+		FBPSizeTypeSizes Sizes;
+		FBPSizeTypeFlags HasKnownSizes;
+		TArray<int32> NextFrontier;
+		TArray<int32> UnresolvedPackages;
+	};
+
+	// Whoever sets a package's bit first owns it, so every package is counted exactly once no matter
+	// how many threads reach it in the same level
+	const int32 numWords = FMath::DivideAndRoundUp(GetNumPackages(), 64);
+	TUniquePtr<std::atomic<uint64>[]> visited = MakeUnique<std::atomic<uint64>[]>(numWords);
+	auto tryVisit = [&visited](int32 PackageIndex)
+	{
+		const uint64 bit = 1ull << (PackageIndex & 63);
+		return (visited[PackageIndex >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+	};
+
+	TArray<int32> frontier;
+	for (const int32 rootIndex : RootIndices)
+	{
+		if (rootIndex != INDEX_NONE && tryVisit(rootIndex))
+		{
+			frontier.Add(rootIndex);
+		}
+	}
+
+	TArray<FChunkResult> chunkResults;
+
+	while (!frontier.IsEmpty())
+	{
+		if (Cancelled && Cancelled->load(std::memory_order_relaxed))
+		{
+			result.WasCancelled = true;
+			return result;
+		}
+
+		const int32 numChunks = FMath::Clamp(frontier.Num() / MinPackagesPerChunk, 1, NumThreads);
+		const int32 packagesPerChunk = FMath::DivideAndRoundUp(frontier.Num(), numChunks);
+
+		chunkResults.Reset();
+		chunkResults.SetNum(numChunks);
+
+		ParallelFor(numChunks, [this, &frontier, &chunkResults, &tryVisit, packagesPerChunk](int32 ChunkIndex)
+		{
+			FChunkResult& chunkResult = chunkResults[ChunkIndex];
+			chunkResult.Sizes.Init(0, SizeTypes.Num());
+			chunkResult.HasKnownSizes.Init(true, SizeTypes.Num());
+			const int32 first = ChunkIndex * packagesPerChunk;
+			const int32 last = FMath::Min(first + packagesPerChunk, frontier.Num());
+
+			for (int32 frontierIndex = first; frontierIndex < last; ++frontierIndex)
+			{
+				const int32 packageIndex = frontier[frontierIndex];
+				if (!Resolved[packageIndex])
+				{
+					chunkResult.UnresolvedPackages.Add(packageIndex);
+					continue;
+				}
+
+				for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+				{
+					chunkResult.Sizes[sizeTypeIndex] += SelfSizes[sizeTypeIndex][packageIndex];
+					chunkResult.HasKnownSizes[sizeTypeIndex] &= KnownSizes[sizeTypeIndex][packageIndex];
+				}
+
+				for (int32 edge = DependencyOffsets[packageIndex]; edge < DependencyOffsets[packageIndex + 1]; ++edge)
+				{
+					const int32 dependencyIndex = DependencyIndices[edge];
+					if (BPSizeDependencyModes::IsHardGame(DependencyModes[edge]) && tryVisit(dependencyIndex))
+					{
+						chunkResult.NextFrontier.Add(dependencyIndex);
+					}
+				}
+			}
+		}, numChunks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+		result.NumPackages += frontier.Num();
+		frontier.Reset();
+
+		for (FChunkResult& chunkResult : chunkResults)
+		{
+			for (int32 sizeTypeIndex = 0; sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+			{
+				result.Sizes[sizeTypeIndex] += chunkResult.Sizes[sizeTypeIndex];
+				result.HasKnownSizes[sizeTypeIndex] &= chunkResult.HasKnownSizes[sizeTypeIndex];
+			}
+			result.UnresolvedPackages.Append(chunkResult.UnresolvedPackages);
+			frontier.Append(chunkResult.NextFrontier);
+		}
+	}
+
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::NodesVisited, result.NumPackages);
+
+	result.ClosureWords.SetNumUninitialized(numWords);
+	for (int32 wordIndex = 0; wordIndex < numWords; ++wordIndex)
+	{
+		result.ClosureWords[wordIndex] = visited[wordIndex].load(std::memory_order_relaxed);
+	}
+
+	return result;
+}
+
+FBPSizeBatchResult FBPSizeGraphSnapshot::CalculateClosures(TConstArrayView<int32> RootIndices, bool FillClosureWords) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::CalculateClosures);
+	SCOPE_CYCLE_COUNTER(STAT_BPSizeClosureWalk);
+
+	const int32 numSizeTypes = SizeTypes.Num();
+
+	FBPSizeBatchResult result;
+	result.Closures.SetNum(RootIndices.Num());
+	for (FBPSizeClosureResult& closure : result.Closures)
+	{
+		closure.InitSizes(numSizeTypes);
+	}
+	result.ExclusiveSizes.SetNum(numSizeTypes);
+	for (TArray<int64>& exclusiveSizes : result.ExclusiveSizes)
+	{
+		exclusiveSizes.Init(0, RootIndices.Num());
+	}
+	result.OverlapSizes.Init(0, numSizeTypes);
+
+	// Roots in the same cycle, or below the same shared subgraph, reuse the closure instead of walking it again
+	FBPSizeCondensation condensation;
+	condensation.Build(*this, RootIndices);
+
+	TArray<uint64> resolvedWords;
+	FBPSizeCondensation::ToWords(Resolved, resolvedWords);
+	TArray<TArray<uint64>> knownSizeWords;
+	knownSizeWords.SetNum(numSizeTypes);
+	for (int32 sizeTypeIndex = 0; sizeTypeIndex < numSizeTypes; ++sizeTypeIndex)
+	{
+		FBPSizeCondensation::ToWords(KnownSizes[sizeTypeIndex], knownSizeWords[sizeTypeIndex]);
+	}
+
+	TArray<uint64> unresolvedWords;
+	unresolvedWords.Reserve(resolvedWords.Num());
+	for (const uint64 resolvedWord : resolvedWords)
+	{
+		unresolvedWords.Add(~resolvedWord);
+	}
+
+	TArray<uint64> reachedWords;
+	reachedWords.Init(0, resolvedWords.Num());
+	TArray<uint64> sharedWords;
+	sharedWords.Init(0, resolvedWords.Num());
+
+	for (int32 rootOrdinal = 0; rootOrdinal < RootIndices.Num(); ++rootOrdinal)
+	{
+		const int32 rootIndex = RootIndices[rootOrdinal];
+		if (rootIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FBPSizeClosureResult& closure = result.Closures[rootOrdinal];
+
+		const FBPSizeSparseBitSet& closureBits = condensation.GetClosure(rootIndex);
+		closure.NumPackages = closureBits.CountSetBits();
+		if (FillClosureWords)
+		{
+			closure.ClosureWords.Init(0, resolvedWords.Num());
+		}
+		for (int32 sizeTypeIndex = 0; sizeTypeIndex < numSizeTypes; ++sizeTypeIndex)
+		{
+			closure.Sizes[sizeTypeIndex] = FBPSizeCondensation::SumMasked(closureBits, unresolvedWords, SelfSizes[sizeTypeIndex]);
+		}
+
+		for (int32 wordOrdinal = 0; wordOrdinal < closureBits.Words.Num(); ++wordOrdinal)
+		{
+			const int32 wordIndex = closureBits.WordIndices[wordOrdinal];
+			const uint64 word = closureBits.Words[wordOrdinal];
+
+			for (int32 sizeTypeIndex = 0; sizeTypeIndex < numSizeTypes; ++sizeTypeIndex)
+			{
+				if (word & resolvedWords[wordIndex] & ~knownSizeWords[sizeTypeIndex][wordIndex])
+				{
+					closure.HasKnownSizes[sizeTypeIndex] = false;
+				}
+			}
+
+			sharedWords[wordIndex] |= reachedWords[wordIndex] & word;
+			reachedWords[wordIndex] |= word;
+			if (FillClosureWords)
+			{
+				closure.ClosureWords[wordIndex] = word;
+			}
+		}
+	}
+
+	// Only known once every root has been summed up
+	TArray<uint64> sharedOrUnresolvedWords;
+	sharedOrUnresolvedWords.Reserve(sharedWords.Num());
+	for (int32 wordIndex = 0; wordIndex < sharedWords.Num(); ++wordIndex)
+	{
+		sharedOrUnresolvedWords.Add(sharedWords[wordIndex] | unresolvedWords[wordIndex]);
+	}
+
+	for (int32 rootOrdinal = 0; rootOrdinal < RootIndices.Num(); ++rootOrdinal)
+	{
+		if (RootIndices[rootOrdinal] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const FBPSizeSparseBitSet& closureBits = condensation.GetClosure(RootIndices[rootOrdinal]);
+		for (int32 sizeTypeIndex = 0; sizeTypeIndex < numSizeTypes; ++sizeTypeIndex)
+		{
+			result.ExclusiveSizes[sizeTypeIndex][rootOrdinal] = FBPSizeCondensation::SumMasked(closureBits, sharedOrUnresolvedWords, SelfSizes[sizeTypeIndex]);
+		}
+	}
+
+	int32 reachedPackages = 0;
+	for (int32 wordIndex = 0; wordIndex < reachedWords.Num(); ++wordIndex)
+	{
+		reachedPackages += FMath::CountBits(reachedWords[wordIndex]);
+
+		for (uint64 sharedWord = sharedWords[wordIndex] & resolvedWords[wordIndex]; sharedWord; sharedWord &= sharedWord - 1)
+		{
+			const int32 packageIndex = wordIndex * 64 + FMath::CountTrailingZeros64(sharedWord);
+			for (int32 sizeTypeIndex = 0; sizeTypeIndex < numSizeTypes; ++sizeTypeIndex)
+			{
+				result.OverlapSizes[sizeTypeIndex] += SelfSizes[sizeTypeIndex][packageIndex];
+			}
+		}
+
+		for (uint64 unresolvedWord = reachedWords[wordIndex] & unresolvedWords[wordIndex]; unresolvedWord; unresolvedWord &= unresolvedWord - 1)
+		{
+			result.UnresolvedPackages.Add(wordIndex * 64 + FMath::CountTrailingZeros64(unresolvedWord));
+		}
+	}
+
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::NodesVisited, reachedPackages);
+
+	return result;
+}
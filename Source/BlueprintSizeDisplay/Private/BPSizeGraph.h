@@ -0,0 +1,313 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManagerEditorModule.h"
+#include "BPSizePackageClassifier.h"
+#include "BPSizeProvider.h"
+#include "IO/IoHash.h"
+
+#include <atomic>
+
+class FBPSizeDiskCache;
+
+// How a package references another one, as the registry reports it
+enum class EBPSizeDependencyFlags : uint8
+{
+	None = 0,
+	Hard = 1 << 0,
+	Soft = 1 << 1,
+	Game = 1 << 2,
+	EditorOnly = 1 << 3
+};
+ENUM_CLASS_FLAGS(EBPSizeDependencyFlags);
+
+// Which references a closure follows. All of them share the same edges, so several closures can be walked together.
+enum class EBPSizeDependencyMode : uint8
+{
+	// Hard references the game loads, the same the SizeMap follows. Sizes are of this mode unless said otherwise.
+	HardGame,
+
+	// Hard references, the editor-only ones included
+	HardEditor,
+
+	// Hard and soft references the game loads, how big the closure can get once everything soft is loaded too
+	SoftGame,
+
+	Num
+};
+
+namespace BPSizeDependencyModes
+{
+	// Bit i stands for EBPSizeDependencyMode i
+	constexpr uint8 HardGame = 1 << static_cast<uint8>(EBPSizeDependencyMode::HardGame);
+	constexpr uint8 All = (1 << static_cast<uint8>(EBPSizeDependencyMode::Num)) - 1;
+
+	// The modes that follow an edge with the given flags
+	inline uint8 GetFollowingModes(EBPSizeDependencyFlags Flags)
+	{
+		const bool isHard = EnumHasAnyFlags(Flags, EBPSizeDependencyFlags::Hard);
+		const bool isGame = EnumHasAnyFlags(Flags, EBPSizeDependencyFlags::Game);
+
+		uint8 modes = 0;
+		modes |= isHard && isGame ? HardGame : 0;
+		modes |= isHard ? 1 << static_cast<uint8>(EBPSizeDependencyMode::HardEditor) : 0;
+		modes |= isGame ? 1 << static_cast<uint8>(EBPSizeDependencyMode::SoftGame) : 0;
+		return modes;
+	}
+
+	// Modes is the mask kept for an edge, every mode following any of the references it stands for
+	inline bool IsHardGame(uint8 Modes)
+	{
+		return (Modes & HardGame) != 0;
+	}
+}
+
+// Sizes are kept for every size type of the graph at once, indexed like FBPSizeGraph::GetSizeTypes
+typedef TArray<int64, TInlineAllocator<2>> FBPSizeTypeSizes;
+typedef TArray<bool, TInlineAllocator<2>> FBPSizeTypeFlags;
+
+struct FBPSizeModeClosure
+{
+	FBPSizeTypeSizes Sizes;
+	FBPSizeTypeFlags HasKnownSizes;
+	int32 NumPackages = 0;
+};
+
+// Indexed by EBPSizeDependencyMode
+typedef TArray<FBPSizeModeClosure, TInlineAllocator<static_cast<int32>(EBPSizeDependencyMode::Num)>> FBPSizeModeClosures;
+
+// Closure along hard game references, plus the closures of the other dependency modes when the walk was asked for them
+struct FBPSizeClosureResult
+{
+	FBPSizeTypeSizes Sizes;
+	FBPSizeTypeFlags HasKnownSizes;
+	int32 NumPackages = 0;
+	bool WasCancelled = false;
+
+	// Packages the walk reached, but whose dependencies are not known yet.
+	// They have to be resolved on the game thread before the closure is complete.
+	TArray<int32> UnresolvedPackages;
+
+	// Bit i of the words is set when package i is in the closure. Only filled in by single walks which weren't cancelled,
+	// and by batch calculations asked for them.
+	TArray<uint64> ClosureWords;
+
+	// Only filled in when more modes than HardGame were walked. Packages reached in any of the modes end up in UnresolvedPackages.
+	FBPSizeModeClosures ModeClosures;
+
+	void InitSizes(int32 NumSizeTypes, bool HasKnownSize = true)
+	{
+		Sizes.Init(0, NumSizeTypes);
+		HasKnownSizes.Init(HasKnownSize, NumSizeTypes);
+	}
+};
+
+struct FBPSizeBatchResult
+{
+	// Per root, in the order the roots were given
+	TArray<FBPSizeClosureResult> Closures;
+
+	// Per size type, then per root, the size of the packages no other root of the batch reaches
+	TArray<TArray<int64>> ExclusiveSizes;
+
+	// Per size type, the size of the packages reached from more than one root
+	TArray<int64> OverlapSizes;
+
+	TArray<int32> UnresolvedPackages;
+};
+
+// How the closure of a package changes when its direct dependencies do, before the change is saved
+struct FBPSizeClosureEstimate
+{
+	// Closure as the graph knows it, from the saved dependencies. Per size type.
+	FBPSizeTypeSizes SavedSizes;
+	FBPSizeTypeSizes EstimatedSizes;
+	FBPSizeTypeFlags HasKnownSizes;
+
+	int32 NumAddedDependencies = 0;
+	int32 NumRemovedDependencies = 0;
+
+	// Packages which enter or leave the closure
+	int32 NumAddedPackages = 0;
+	int32 NumRemovedPackages = 0;
+};
+
+struct FBPSizePackageSize
+{
+	FName PackageName;
+	int64 Size = 0;
+};
+
+// An edge from a package that was already in the closure to one that wasn't
+struct FBPSizeEdgeContribution
+{
+	FName ReferencerName;
+	FName DependencyName;
+
+	// The new packages reached through the edge. Several edges can reach the same package, so these overlap.
+	int64 Size = 0;
+	int32 NumPackages = 0;
+};
+
+// Why a closure differs from an earlier closure of the same package
+struct FBPSizeClosureChange
+{
+	int64 AddedSize = 0;
+	int64 RemovedSize = 0;
+
+	// Biggest first
+	TArray<FBPSizeEdgeContribution> AddedEdges;
+	TArray<FBPSizePackageSize> RemovedPackages;
+	int32 NumAddedPackages = 0;
+};
+
+// Immutable copy of the graph with all dependency lists flattened into a single array.
+// Can be read from any thread while the graph itself keeps changing on the game thread.
+struct FBPSizeGraphSnapshot
+{
+	int32 Generation = 0;
+
+	// Dependencies of package i are DependencyIndices[DependencyOffsets[i]] .. DependencyIndices[DependencyOffsets[i + 1] - 1],
+	// every kind of reference, with the modes following every edge in DependencyModes
+	TArray<int32> DependencyOffsets;
+	TArray<int32> DependencyIndices;
+	TArray<uint8> DependencyModes;
+	TBitArray<> Resolved;
+
+	// Per size type, then per package
+	TArray<FName> SizeTypes;
+	TArray<TArray<int64>> SelfSizes;
+	TArray<TBitArray<>> KnownSizes;
+
+	int32 GetNumPackages() const { return Resolved.Num(); }
+	int32 FindSizeType(const FName& SizeType) const { return SizeTypes.Find(SizeType); }
+
+	// With more than one thread the closure is expanded a whole frontier at a time with ParallelFor.
+	// The totals are the same either way, only the order of UnresolvedPackages may differ.
+	// Modes is a mask of BPSizeDependencyModes, anything beyond hard game references is walked on one thread,
+	// a package is walked again only for the modes that hadn't reached it yet.
+	FBPSizeClosureResult CalculateClosure(int32 RootIndex, const std::atomic<bool>* Cancelled = nullptr, int32 NumThreads = 1, uint8 Modes = BPSizeDependencyModes::HardGame) const;
+
+	// Closure of all the roots together, every package is counted once even if several roots reach it
+	FBPSizeClosureResult CalculateUnionClosure(TConstArrayView<int32> RootIndices, const std::atomic<bool>* Cancelled = nullptr, int32 NumThreads = 1, uint8 Modes = BPSizeDependencyModes::HardGame) const;
+
+	// Separate closures for every root, plus how much of them the roots share.
+	// The reachable graph is condensed into strongly connected components first, so every closure is built once
+	// per component from the closures below it, and summed up from a bit set instead of walked.
+	// Expects the union closure of the roots to be resolved already.
+	FBPSizeBatchResult CalculateClosures(TConstArrayView<int32> RootIndices, bool FillClosureWords = false) const;
+
+private:
+	FBPSizeClosureResult CalculateClosureSerial(TConstArrayView<int32> RootIndices, const std::atomic<bool>* Cancelled, uint8 Modes) const;
+	FBPSizeClosureResult CalculateClosureParallel(TConstArrayView<int32> RootIndices, const std::atomic<bool>* Cancelled, int32 NumThreads) const;
+};
+
+// Flat, index based view of the package dependency graph. Every kind of package reference is fetched once and kept
+// with the modes following it, closures only follow the edges of their dependency mode, hard game references unless said otherwise.
+// Packages get a dense index the first time they are seen, so the closure of an asset can be summed up
+// with a bit array as the visited set and without creating any tree nodes or strings.
+// The graph lives as long as its owner and works as a memo: every package keeps its direct dependencies and
+// self size until it gets invalidated, so recalculating a closure only queries the registry for changed packages.
+class FBPSizeGraph
+{
+public:
+	FBPSizeGraph(IAssetManagerEditorModule& InEditorModule, const FAssetManagerEditorRegistrySource& InRegistrySource);
+
+	// Sums up the sizes of the package and everything it (transitively) hard references, for every size type.
+	// Blocks until the whole closure is resolved, the async path uses snapshots and ResolvePackages instead.
+	void CalculateClosureSize(const FName& RootPackageName, FBPSizeClosureResult& OutResult);
+
+	// Sizes many packages in one go. The registry is only queried once per package for the whole batch,
+	// no matter how many of the roots share it.
+	void CalculateClosureSizes(TConstArrayView<FName> RootPackageNames, FBPSizeBatchResult& OutResult);
+
+	// Every package the root (transitively) hard references, the root included. Blocks like CalculateClosureSize.
+	void GatherClosurePackages(const FName& RootPackageName, TArray<FName>& OutPackageNames);
+
+	// Closure of the package as if its direct hard game dependencies were the given ones instead of the saved ones.
+	// Only the closures of the added and removed dependencies get walked and diffed against the saved closure.
+	// The self size of the package itself stays the saved one. Blocks like CalculateClosureSize.
+	void EstimateClosureSize(const FName& RootPackageName, TConstArrayView<FName> NewDependencyNames, FBPSizeClosureEstimate& OutEstimate);
+
+	int32 FindOrAddPackage(const FName& PackageName);
+
+	// Indexed the same way as the snapshots
+	const TArray<FName>& GetPackageNames() const { return PackageNames; }
+	void ResolvePackages(TConstArrayView<int32> Indices);
+
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> GetSnapshot();
+
+	// Memory and disk sizes are always collected, other custom columns of the editor module once they are asked for.
+	// Adding one throws away everything memoized so far, the packages have no sizes of that type yet.
+	// Indices never change, a size type once added stays.
+	int32 FindOrAddSizeType(const FName& SizeTypeToCalculate);
+	int32 FindSizeType(const FName& SizeTypeToCalculate) const { return SizeTypes.Find(SizeTypeToCalculate); }
+	const TArray<FName>& GetSizeTypes() const { return SizeTypes; }
+
+	// Changes whenever the graph gets reset, package indices from an older generation are meaningless
+	int32 GetGeneration() const { return Generation; }
+
+	// Queries the package again and, unless its size and dependencies turned out to be the same as before,
+	// reports every known package whose closure contained it, including the package itself
+	void InvalidatePackage(const FName& PackageName, TArray<FName>& OutAffectedPackages);
+
+	// Every kind of edge, in no particular order
+	const TArray<int32>& GetReferencers(int32 PackageIndex) const { return Referencers[PackageIndex]; }
+	bool IsHardGameDependency(int32 ReferencerIndex, int32 DependencyIndex) const;
+
+	// Packages whose referencers changed since the last call, for the indices kept outside the graph to catch up with.
+	// Resets of the graph aren't reported, those change the generation.
+	void ConsumeReferencerChanges(TArray<int32>& OutPackageIndices);
+
+	// Set difference of two closures of the same generation, as ClosureWords of FBPSizeClosureResult, sized in one size type.
+	// The new packages are attributed to the edges they were entered through, found via the referencers
+	// of the new packages, so nothing outside the difference gets walked.
+	void AttributeClosureChange(TConstArrayView<uint64> OldClosureWords, TConstArrayView<uint64> NewClosureWords, int32 SizeTypeIndex, FBPSizeClosureChange& OutChange) const;
+
+	// Resolving a package whose saved hash matches the disk cache takes its data from there instead of the registry
+	void SetDiskCache(const FBPSizeDiskCache* InDiskCache) { DiskCache = InDiskCache; }
+	void ExportToDiskCache(FBPSizeDiskCache& OutDiskCache) const;
+
+	// Outlives resets of the graph, its sizes are kept per size type
+	FBPSizeProvider& GetSizeProvider() { return SizeProvider; }
+
+	void Reset();
+
+private:
+	void ResolvePackage(int32 PackageIndex);
+
+	// Level by level, so the packages of a frontier get resolved in one batch.
+	// Packages already set in InOutVisited are neither reported nor walked past.
+	void WalkClosure(TConstArrayView<int32> RootIndices, TBitArray<>& InOutVisited, TArray<int32>& OutReached);
+
+	// Returns false when there's no size to look up for the package, either because the asset is missing
+	// or because the disk cache already had it
+	bool ResolvePackageDependencies(int32 PackageIndex, FAssetData& OutAssetData);
+	void ResolveSelfSizes(TConstArrayView<int32> Indices, TConstArrayView<FAssetData> Assets);
+	void SetDependencies(int32 PackageIndex, TArray<int32>&& NewDependencies, TArray<uint8>&& NewDependencyModes);
+	bool ResolvePackageFromDiskCache(int32 PackageIndex);
+
+	IAssetManagerEditorModule& EditorModule;
+	const FAssetManagerEditorRegistrySource& RegistrySource;
+	TArray<FName> SizeTypes;
+	int32 Generation = 0;
+	TSharedPtr<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> CachedSnapshot;
+	const FBPSizeDiskCache* DiskCache = nullptr;
+	FBPSizeProvider SizeProvider;
+
+	TMap<FName, int32> PackageIndices;
+	TArray<FName> PackageNames;
+	TBitArray<> Resolved;
+
+	// Per size type, then per package, so a walk sums up every size type from contiguous arrays
+	TArray<TArray<int64>> SelfSizes;
+	TArray<TBitArray<>> KnownSizes;
+	TArray<TArray<int32>> Dependencies;
+	TArray<TArray<uint8>> DependencyModes;
+	TArray<FIoHash> SavedHashes;
+
+	// Reverse of Dependencies, every kind of edge, used to find the closures a changed package is part of
+	TArray<TArray<int32>> Referencers;
+	TBitArray<> ReferencersChanged;
+	int32 NumReferencersChanged = 0;
+};
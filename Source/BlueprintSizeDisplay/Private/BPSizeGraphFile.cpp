@@ -0,0 +1,225 @@
+#include "BPSizeGraphFile.h"
+
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 GraphFileMagic = 0x47535042; // "BPSG"
+
+	// Bump whenever the layout changes, older files are then rejected
+	constexpr uint32 GraphFileVersion = 2;
+}
+
+void FBPSizeGraphFile::Capture(const FBPSizeGraphSnapshot& Snapshot, TConstArrayView<FName> SnapshotPackageNames)
+{
+	if (PackageNames.IsEmpty())
+	{
+		PackageNames = TArray<FName>(SnapshotPackageNames);
+		DependencyOffsets = Snapshot.DependencyOffsets;
+		DependencyIndices = Snapshot.DependencyIndices;
+		DependencyModes = Snapshot.DependencyModes;
+
+		PackageIndices.Empty(PackageNames.Num());
+		for (int32 packageIndex = 0; packageIndex < PackageNames.Num(); ++packageIndex)
+		{
+			PackageIndices.Add(PackageNames[packageIndex], packageIndex);
+		}
+	}
+
+	for (int32 snapshotSizeTypeIndex = 0; snapshotSizeTypeIndex < Snapshot.SizeTypes.Num(); ++snapshotSizeTypeIndex)
+	{
+		if (SizeTypes.Contains(Snapshot.SizeTypes[snapshotSizeTypeIndex]))
+		{
+			continue;
+		}
+
+		SizeTypes.Add(Snapshot.SizeTypes[snapshotSizeTypeIndex]);
+		TArray<int64>& selfSizes = SelfSizes.AddDefaulted_GetRef();
+		TBitArray<>& knownSizes = KnownSizes.AddDefaulted_GetRef();
+		selfSizes.Init(0, PackageNames.Num());
+		knownSizes.Init(false, PackageNames.Num());
+
+		// Package indices differ between captures, the live graph resets whenever a size type gets added
+		for (int32 snapshotIndex = 0; snapshotIndex < SnapshotPackageNames.Num(); ++snapshotIndex)
+		{
+			const int32 packageIndex = FindPackage(SnapshotPackageNames[snapshotIndex]);
+			if (packageIndex != INDEX_NONE)
+			{
+				selfSizes[packageIndex] = Snapshot.SelfSizes[snapshotSizeTypeIndex][snapshotIndex];
+				knownSizes[packageIndex] = Snapshot.KnownSizes[snapshotSizeTypeIndex][snapshotIndex];
+			}
+		}
+	}
+}
+
+TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> FBPSizeGraphFile::MakeSnapshot() const
+{
+	TSharedRef<FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = MakeShared<FBPSizeGraphSnapshot, ESPMode::ThreadSafe>();
+	snapshot->DependencyOffsets = DependencyOffsets;
+	snapshot->DependencyIndices = DependencyIndices;
+	snapshot->DependencyModes = DependencyModes;
+	snapshot->SizeTypes = SizeTypes;
+	snapshot->SelfSizes = SelfSizes;
+	snapshot->KnownSizes = KnownSizes;
+
+	// Nothing is left to resolve, everything the capture didn't know about simply isn't in the file
+	snapshot->Resolved.Init(true, PackageNames.Num());
+
+	return snapshot;
+}
+
+int32 FBPSizeGraphFile::FindPackage(const FName& PackageName) const
+{
+	const int32* packageIndex = PackageIndices.Find(PackageName);
+	return packageIndex ? *packageIndex : INDEX_NONE;
+}
+
+bool FBPSizeGraphFile::Load(const FString& Filename)
+{
+	// Everything gets copied into the arrays anyway, so the file is simply read in one go
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *Filename, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader reader(bytes);
+	Serialize(reader);
+
+	if (reader.IsError())
+	{
+		*this = FBPSizeGraphFile();
+		return false;
+	}
+
+	PackageIndices.Empty(PackageNames.Num());
+	for (int32 packageIndex = 0; packageIndex < PackageNames.Num(); ++packageIndex)
+	{
+		PackageIndices.Add(PackageNames[packageIndex], packageIndex);
+	}
+
+	return true;
+}
+
+bool FBPSizeGraphFile::Save(const FString& Filename) const
+{
+	TArray<uint8> bytes;
+	FMemoryWriter writer(bytes);
+	const_cast<FBPSizeGraphFile*>(this)->Serialize(writer);
+
+	return FFileHelper::SaveArrayToFile(bytes, *Filename);
+}
+
+void FBPSizeGraphFile::Serialize(FArchive& Ar)
+{
+	uint32 magic = GraphFileMagic;
+	uint32 version = GraphFileVersion;
+	Ar << magic;
+	Ar << version;
+
+	if (Ar.IsLoading() && (magic != GraphFileMagic || version != GraphFileVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	// A truncated or corrupt file must not get anything allocated for more elements than its remaining bytes can hold.
+	// The arrays are written the way operator<< writes them, but their counts are checked before they get resized.
+	auto isValidCount = [&Ar](int32 Count, int64 MinElementSize)
+	{
+		return Count >= 0 && Count <= (Ar.TotalSize() - Ar.Tell()) / MinElementSize;
+	};
+
+	auto serializeArray = [&Ar, &isValidCount](auto& Array, int64 MinElementSize, auto&& SerializeElement)
+	{
+		int32 num = Array.Num();
+		Ar << num;
+		if (Ar.IsLoading())
+		{
+			if (!isValidCount(num, MinElementSize))
+			{
+				Ar.SetError();
+				return;
+			}
+			Array.SetNum(num);
+		}
+		for (int32 elementIndex = 0; elementIndex < num && !Ar.IsError(); ++elementIndex)
+		{
+			SerializeElement(Array[elementIndex]);
+		}
+	};
+
+	auto serializeValue = [&Ar](auto& Value)
+	{
+		Ar << Value;
+	};
+
+	// Names as plain strings, so the file can be read by anything, not only a process with the same name table
+	auto serializeName = [&Ar](FName& Name)
+	{
+		FString nameString = Name.ToString();
+		Ar << nameString;
+		Name = FName(*nameString);
+	};
+
+	// The bit count comes first, it's peeked at so the words can be checked before the bit array allocates them
+	auto serializeBits = [&Ar, &isValidCount](TBitArray<>& Bits)
+	{
+		if (Ar.IsLoading())
+		{
+			const int64 bitsStart = Ar.Tell();
+			int32 numBits = 0;
+			Ar << numBits;
+			Ar.Seek(bitsStart);
+			if (numBits < 0 || !isValidCount(FMath::DivideAndRoundUp(numBits, 32), sizeof(uint32)))
+			{
+				Ar.SetError();
+				return;
+			}
+		}
+		Ar << Bits;
+	};
+
+	serializeArray(RootPackageNames, sizeof(int32), serializeName);
+	serializeArray(PackageNames, sizeof(int32), serializeName);
+	serializeArray(SizeTypes, sizeof(int32), serializeName);
+
+	serializeArray(DependencyOffsets, sizeof(int32), serializeValue);
+	serializeArray(DependencyIndices, sizeof(int32), serializeValue);
+	serializeArray(DependencyModes, sizeof(uint8), serializeValue);
+
+	serializeArray(SelfSizes, sizeof(int32), [&serializeArray, &serializeValue](TArray<int64>& Sizes) { serializeArray(Sizes, sizeof(int64), serializeValue); });
+	serializeArray(KnownSizes, sizeof(int32), serializeBits);
+
+	if (Ar.IsLoading() && !Ar.IsError())
+	{
+		// Everything below indexes by these, a damaged file must not get that far
+		const int32 numPackages = PackageNames.Num();
+		bool isValid = DependencyOffsets.Num() == numPackages + 1
+			&& DependencyOffsets[0] == 0
+			&& DependencyOffsets.Last() == DependencyIndices.Num()
+			&& DependencyModes.Num() == DependencyIndices.Num()
+			&& SelfSizes.Num() == SizeTypes.Num()
+			&& KnownSizes.Num() == SizeTypes.Num();
+
+		for (int32 packageIndex = 0; isValid && packageIndex < numPackages; ++packageIndex)
+		{
+			isValid = DependencyOffsets[packageIndex] <= DependencyOffsets[packageIndex + 1];
+		}
+		for (int32 edge = 0; isValid && edge < DependencyIndices.Num(); ++edge)
+		{
+			isValid = DependencyIndices[edge] >= 0 && DependencyIndices[edge] < numPackages;
+		}
+		for (int32 sizeTypeIndex = 0; isValid && sizeTypeIndex < SizeTypes.Num(); ++sizeTypeIndex)
+		{
+			isValid = SelfSizes[sizeTypeIndex].Num() == numPackages && KnownSizes[sizeTypeIndex].Num() == numPackages;
+		}
+
+		if (!isValid)
+		{
+			Ar.SetError();
+		}
+	}
+}
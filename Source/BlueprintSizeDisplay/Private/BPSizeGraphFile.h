@@ -0,0 +1,43 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BPSizeGraph.h"
+
+// Offline copy of the dependency graph: a dense package table, the edges in compressed sparse row form with the
+// dependency modes of every edge, and the self sizes for every captured size type.
+// Turned back into an FBPSizeGraphSnapshot, it runs through the same closure code as the live graph, without
+// the project or its asset registry.
+struct FBPSizeGraphFile
+{
+	// The packages the capture was made for, the ones a replay sizes
+	TArray<FName> RootPackageNames;
+
+	TArray<FName> PackageNames;
+
+	// Dependencies of package i are DependencyIndices[DependencyOffsets[i]] .. DependencyIndices[DependencyOffsets[i + 1] - 1]
+	TArray<int32> DependencyOffsets;
+	TArray<int32> DependencyIndices;
+	TArray<uint8> DependencyModes;
+
+	// Per size type, then per package
+	TArray<FName> SizeTypes;
+	TArray<TArray<int64>> SelfSizes;
+	TArray<TBitArray<>> KnownSizes;
+
+	// Takes every size type of the snapshot. The first capture decides the packages and edges,
+	// later ones only add the sizes of size types the file doesn't have yet.
+	void Capture(const FBPSizeGraphSnapshot& Snapshot, TConstArrayView<FName> SnapshotPackageNames);
+
+	// With every captured size type
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> MakeSnapshot() const;
+
+	int32 FindPackage(const FName& PackageName) const;
+
+	bool Load(const FString& Filename);
+	bool Save(const FString& Filename) const;
+
+private:
+	void Serialize(FArchive& Ar);
+
+	TMap<FName, int32> PackageIndices;
+};
@@ -0,0 +1,79 @@
+#include "BPSizeLazyTree.h"
+
+FBPSizeLazyTree::FBPSizeLazyTree(const TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe>& InSnapshot, TConstArrayView<FName> InPackageNames, int32 RootIndex, int32 InSizeTypeIndex) :
+	Snapshot(InSnapshot),
+	PackageNames(InPackageNames),
+	SizeTypeIndex(InSizeTypeIndex)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::BuildLazyTree);
+
+	if (RootIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// The node array doubles as the queue of the breadth first walk
+	TBitArray<> visited(false, Snapshot->GetNumPackages());
+	visited[RootIndex] = true;
+	Nodes.AddDefaulted_GetRef().PackageIndex = RootIndex;
+
+	for (int32 nodeId = 0; nodeId < Nodes.Num(); ++nodeId)
+	{
+		const int32 packageIndex = Nodes[nodeId].PackageIndex;
+		const int32 firstChild = Nodes.Num();
+
+		if (Snapshot->Resolved[packageIndex])
+		{
+			for (int32 edge = Snapshot->DependencyOffsets[packageIndex]; edge < Snapshot->DependencyOffsets[packageIndex + 1]; ++edge)
+			{
+				const int32 dependencyIndex = Snapshot->DependencyIndices[edge];
+				if (!visited[dependencyIndex] && BPSizeDependencyModes::IsHardGame(Snapshot->DependencyModes[edge]))
+				{
+					visited[dependencyIndex] = true;
+
+					FNode& child = Nodes.AddDefaulted_GetRef();
+					child.PackageIndex = dependencyIndex;
+					child.Parent = nodeId;
+				}
+			}
+		}
+
+		FNode& node = Nodes[nodeId];
+		node.FirstChild = firstChild;
+		node.NumChildren = Nodes.Num() - firstChild;
+		node.TotalSize = Snapshot->SelfSizes[SizeTypeIndex][packageIndex];
+		node.NumPackages = 1;
+		node.HasKnownSize = Snapshot->KnownSizes[SizeTypeIndex][packageIndex];
+	}
+
+	// Children always come after their parent, so going backwards finishes every subtree before its parent is reached
+	for (int32 nodeId = Nodes.Num() - 1; nodeId > RootNode; --nodeId)
+	{
+		const FNode& node = Nodes[nodeId];
+		FNode& parent = Nodes[node.Parent];
+		parent.TotalSize += node.TotalSize;
+		parent.NumPackages += node.NumPackages;
+		parent.HasKnownSize &= node.HasKnownSize;
+	}
+
+	ChildOrder.SetNumUninitialized(Nodes.Num());
+	for (int32 nodeId = 0; nodeId < Nodes.Num(); ++nodeId)
+	{
+		ChildOrder[nodeId] = nodeId;
+	}
+	ChildrenSorted.Init(false, Nodes.Num());
+}
+
+TConstArrayView<int32> FBPSizeLazyTree::GetSortedChildren(int32 NodeId)
+{
+	const FNode& node = Nodes[NodeId];
+	TArrayView<int32> children = MakeArrayView(ChildOrder).Slice(node.FirstChild, node.NumChildren);
+
+	if (!ChildrenSorted[NodeId])
+	{
+		children.Sort([this](int32 A, int32 B) { return Nodes[A].TotalSize > Nodes[B].TotalSize; });
+		ChildrenSorted[NodeId] = true;
+	}
+
+	return children;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BPSizeGraph.h"
+
+// The SizeMap breakdown of a closure without building it: every package shows up once, under the first package
+// found referencing it breadth first. Only the subtree totals are computed up front, the children of a node get
+// sorted the first time they are asked for. Nodes are numbered breadth first, so the children of a node are contiguous.
+class FBPSizeLazyTree
+{
+public:
+	struct FNode
+	{
+		int32 PackageIndex = INDEX_NONE;
+		int32 Parent = INDEX_NONE;
+		int32 FirstChild = 0;
+		int32 NumChildren = 0;
+
+		// The package and everything below it
+		int64 TotalSize = 0;
+		int32 NumPackages = 0;
+		bool HasKnownSize = true;
+	};
+
+	static constexpr int32 RootNode = 0;
+
+	// Expects the closure of the root to be resolved in the snapshot, unresolved packages end up as leaves.
+	// Sized in one of the size types of the snapshot.
+	FBPSizeLazyTree(const TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe>& InSnapshot, TConstArrayView<FName> InPackageNames, int32 RootIndex, int32 InSizeTypeIndex);
+
+	int32 GetNumNodes() const { return Nodes.Num(); }
+	const FNode& GetNode(int32 NodeId) const { return Nodes[NodeId]; }
+	const FName& GetPackageName(int32 NodeId) const { return PackageNames[Nodes[NodeId].PackageIndex]; }
+	int64 GetSelfSize(int32 NodeId) const { return Snapshot->SelfSizes[SizeTypeIndex][Nodes[NodeId].PackageIndex]; }
+	bool HasKnownSelfSize(int32 NodeId) const { return Snapshot->KnownSizes[SizeTypeIndex][Nodes[NodeId].PackageIndex]; }
+
+	// Biggest subtree first
+	TConstArrayView<int32> GetSortedChildren(int32 NodeId);
+
+private:
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> Snapshot;
+	TArray<FName> PackageNames;
+	int32 SizeTypeIndex = 0;
+	TArray<FNode> Nodes;
+
+	// Node ids, the children of node i at [FirstChild, FirstChild + NumChildren) once ChildrenSorted[i] is set
+	TArray<int32> ChildOrder;
+	TBitArray<> ChildrenSorted;
+};
@@ -0,0 +1,73 @@
+#include "BPSizeManagerIndex.h"
+
+#include "BPSizeStats.h"
+
+FBPSizeManagerIndex::FBPSizeManagerIndex(const FAssetManagerEditorRegistrySource& InRegistrySource) :
+	RegistrySource(InRegistrySource)
+{
+}
+
+bool FBPSizeManagerIndex::IsManagedBy(const FName& PackageName, const FPrimaryAssetId& Manager)
+{
+	return FindOrBuildManagedPackages(Manager).Contains(PackageName);
+}
+
+const TSet<FName>& FBPSizeManagerIndex::FindOrBuildManagedPackages(const FPrimaryAssetId& Manager)
+{
+	if (const TSet<FName>* existingPackages = ManagedPackages.Find(Manager))
+	{
+		return *existingPackages;
+	}
+
+	// Same edges GetReferencers walks backwards, direct and indirect management alike
+	TArray<FAssetIdentifier> managedAssets;
+	RegistrySource.GetDependencies(FAssetIdentifier(Manager), managedAssets, UE::AssetRegistry::EDependencyCategory::Manage);
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::DependencyQueries);
+
+	TSet<FName>& packages = ManagedPackages.Add(Manager);
+	packages.Reserve(managedAssets.Num());
+	for (const FAssetIdentifier& managedAsset : managedAssets)
+	{
+		if (managedAsset.IsPackage())
+		{
+			packages.Add(managedAsset.PackageName);
+			PackageManagers.FindOrAdd(managedAsset.PackageName).Add(Manager);
+		}
+	}
+
+	return packages;
+}
+
+void FBPSizeManagerIndex::InvalidatePackage(const FName& PackageName)
+{
+	if (ManagedPackages.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FPrimaryAssetId> oldManagers;
+	PackageManagers.RemoveAndCopyValue(PackageName, oldManagers);
+	for (const FPrimaryAssetId& oldManager : oldManagers)
+	{
+		ManagedPackages.FindChecked(oldManager).Remove(PackageName);
+	}
+
+	TArray<FAssetIdentifier> managers;
+	RegistrySource.GetReferencers(FAssetIdentifier(PackageName), managers, UE::AssetRegistry::EDependencyCategory::Manage);
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::ReferencerQueries);
+	for (const FAssetIdentifier& manager : managers)
+	{
+		const FPrimaryAssetId managerId = manager.GetPrimaryAssetId();
+		if (TSet<FName>* packages = ManagedPackages.Find(managerId))
+		{
+			packages->Add(PackageName);
+			PackageManagers.FindOrAdd(PackageName).Add(managerId);
+		}
+	}
+}
+
+void FBPSizeManagerIndex::Reset()
+{
+	ManagedPackages.Empty();
+	PackageManagers.Empty();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManagerEditorModule.h"
+
+// Which packages every primary asset manages, so filtered walks can check membership with a hash lookup
+// instead of fetching and scanning the managers of every dependency.
+// A primary asset's set is built the first time it's asked about and kept up to date per package afterwards.
+class FBPSizeManagerIndex
+{
+public:
+	explicit FBPSizeManagerIndex(const FAssetManagerEditorRegistrySource& InRegistrySource);
+
+	bool IsManagedBy(const FName& PackageName, const FPrimaryAssetId& Manager);
+
+	// Queries the managers of the package again, for the primary assets already indexed
+	void InvalidatePackage(const FName& PackageName);
+	void Reset();
+
+private:
+	const TSet<FName>& FindOrBuildManagedPackages(const FPrimaryAssetId& Manager);
+
+	const FAssetManagerEditorRegistrySource& RegistrySource;
+
+	TMap<FPrimaryAssetId, TSet<FName>> ManagedPackages;
+
+	// Reverse of ManagedPackages, only for the indexed primary assets
+	TMap<FName, TArray<FPrimaryAssetId>> PackageManagers;
+};
@@ -0,0 +1,20 @@
+#include "BPSizePackageClassifier.h"
+
+bool FBPSizePackageClassifier::IsScriptPackage(const FName& PackageName)
+{
+	// The builder lives on the stack, unlike the FString ToString would return
+	FNameBuilder packageNameBuilder(PackageName);
+	return packageNameBuilder.ToView().StartsWith(TEXT("/Script/"));
+}
+
+FSoftObjectPath FBPSizePackageClassifier::MakeMainAssetPath(const FName& PackageName)
+{
+	FNameBuilder packageNameBuilder(PackageName);
+	const FStringView packageNameView = packageNameBuilder.ToView();
+
+	int32 lastSlash = INDEX_NONE;
+	packageNameView.FindLastChar(TEXT('/'), lastSlash);
+	const FName assetName(packageNameView.RightChop(lastSlash + 1));
+
+	return FSoftObjectPath(FTopLevelAssetPath(PackageName, assetName));
+}
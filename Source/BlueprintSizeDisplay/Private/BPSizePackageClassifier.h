@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+
+// Looks at package names on the stack, without allocating strings for them
+class FBPSizePackageClassifier
+{
+public:
+	// Native packages have no asset data and no dependencies worth walking. A prefix compare costs less than remembering the answer.
+	static bool IsScriptPackage(const FName& PackageName);
+
+	// Path of the asset named after its package, what the registry is asked for. Built without any string allocation.
+	static FSoftObjectPath MakeMainAssetPath(const FName& PackageName);
+};
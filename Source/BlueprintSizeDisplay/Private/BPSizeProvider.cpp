@@ -0,0 +1,128 @@
+#include "BPSizeProvider.h"
+
+#include "Async/ParallelFor.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "BPSizeStats.h"
+
+FBPSizeProvider::FBPSizeProvider(IAssetManagerEditorModule& InEditorModule, const FAssetManagerEditorRegistrySource& InRegistrySource) :
+	EditorModule(InEditorModule),
+	RegistrySource(InRegistrySource)
+{
+}
+
+const FBPSizeProvider::FCachedSize* FBPSizeProvider::FindCachedSize(const FName& PackageName, const FName& SizeType) const
+{
+	if (const TArray<FCachedSize, TInlineAllocator<2>>* packageSizes = CachedSizes.Find(PackageName))
+	{
+		return packageSizes->FindByPredicate([&SizeType](const FCachedSize& CachedSize) { return CachedSize.SizeType == SizeType; });
+	}
+	return nullptr;
+}
+
+void FBPSizeProvider::AddCachedSize(const FName& PackageName, const FName& SizeType, int64 Size, bool HasKnownSize)
+{
+	CachedSizes.FindOrAdd(PackageName).Add(FCachedSize { SizeType, Size, HasKnownSize });
+}
+
+void FBPSizeProvider::Prefetch(TConstArrayView<FAssetData> Assets, const FName& SizeType)
+{
+	TArray<const FAssetData*> missingAssets;
+	for (const FAssetData& asset : Assets)
+	{
+		if (asset.IsValid() && !FindCachedSize(asset.PackageName, SizeType))
+		{
+			missingAssets.Add(&asset);
+		}
+	}
+
+	if (missingAssets.IsEmpty())
+	{
+		return;
+	}
+	NumPrefetched += missingAssets.Num();
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::SizeLookups, missingAssets.Num());
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::SizesPrefetched, missingAssets.Num());
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::PrefetchSizes);
+
+	// The editor's disk sizes come straight from the package data, which the registry hands out from any thread.
+	// Every other size goes through the editor module, which is only safe to call from the game thread.
+	const bool isEditorDiskSize = SizeType == IAssetManagerEditorModule::DiskSizeName
+		&& RegistrySource.SourceName == FAssetManagerEditorRegistrySource::EditorSourceName;
+
+	TArray<int64> sizes;
+	sizes.Init(0, missingAssets.Num());
+	TBitArray<> knownSizes(false, missingAssets.Num());
+
+	if (isEditorDiskSize)
+	{
+		TArray<bool> foundSizes;
+		foundSizes.Init(false, missingAssets.Num());
+
+		const IAssetRegistry& assetRegistry = IAssetRegistry::GetChecked();
+		ParallelFor(missingAssets.Num(), [&assetRegistry, &missingAssets, &sizes, &foundSizes](int32 AssetOrdinal)
+		{
+			TOptional<FAssetPackageData> packageData = assetRegistry.GetAssetPackageDataCopy(missingAssets[AssetOrdinal]->PackageName);
+			if (packageData.IsSet() && packageData->DiskSize >= 0)
+			{
+				sizes[AssetOrdinal] = packageData->DiskSize;
+				foundSizes[AssetOrdinal] = true;
+			}
+		});
+
+		for (int32 assetOrdinal = 0; assetOrdinal < missingAssets.Num(); ++assetOrdinal)
+		{
+			knownSizes[assetOrdinal] = foundSizes[assetOrdinal];
+		}
+	}
+	else
+	{
+		for (int32 assetOrdinal = 0; assetOrdinal < missingAssets.Num(); ++assetOrdinal)
+		{
+			knownSizes[assetOrdinal] = EditorModule.GetIntegerValueForCustomColumn(*missingAssets[assetOrdinal], SizeType, sizes[assetOrdinal]);
+		}
+	}
+
+	for (int32 assetOrdinal = 0; assetOrdinal < missingAssets.Num(); ++assetOrdinal)
+	{
+		AddCachedSize(missingAssets[assetOrdinal]->PackageName, SizeType, sizes[assetOrdinal], knownSizes[assetOrdinal]);
+	}
+}
+
+bool FBPSizeProvider::GetSize(const FAssetData& Asset, const FName& SizeType, int64& OutSize)
+{
+	if (const FCachedSize* cachedSize = FindCachedSize(Asset.PackageName, SizeType))
+	{
+		++NumHits;
+		FBPSizeStats::Increment(FBPSizeStats::ECounter::CacheHits);
+		OutSize = cachedSize->Size;
+		return cachedSize->HasKnownSize;
+	}
+
+	++NumMisses;
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::SizeLookups);
+	FBPSizeStats::Increment(FBPSizeStats::ECounter::CacheMisses);
+	int64 size = 0;
+	const bool hasKnownSize = EditorModule.GetIntegerValueForCustomColumn(Asset, SizeType, size);
+	AddCachedSize(Asset.PackageName, SizeType, size, hasKnownSize);
+
+	OutSize = size;
+	return hasKnownSize;
+}
+
+void FBPSizeProvider::InvalidatePackage(const FName& PackageName)
+{
+	CachedSizes.Remove(PackageName);
+}
+
+void FBPSizeProvider::Reset()
+{
+	CachedSizes.Empty();
+}
+
+void FBPSizeProvider::ResetCounters()
+{
+	NumHits = 0;
+	NumMisses = 0;
+	NumPrefetched = 0;
+}
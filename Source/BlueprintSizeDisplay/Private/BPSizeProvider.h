@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManagerEditorModule.h"
+
+// Self sizes of packages, cached per size type until the package is saved again.
+// Sizes of a whole frontier can be fetched in one go, disk sizes of the editor registry are then read in parallel.
+class FBPSizeProvider
+{
+public:
+	FBPSizeProvider(IAssetManagerEditorModule& InEditorModule, const FAssetManagerEditorRegistrySource& InRegistrySource);
+
+	// Fills the cache for every asset that isn't in it yet
+	void Prefetch(TConstArrayView<FAssetData> Assets, const FName& SizeType);
+
+	// Same as IAssetManagerEditorModule::GetIntegerValueForCustomColumn, but served from the cache when possible
+	bool GetSize(const FAssetData& Asset, const FName& SizeType, int64& OutSize);
+
+	// Forgets the sizes of the package for every size type
+	void InvalidatePackage(const FName& PackageName);
+	void Reset();
+
+	// Hits and misses count GetSize calls, a miss being a size that had to be looked up on its own.
+	// Sizes looked up by Prefetch are counted separately.
+	uint64 GetNumHits() const { return NumHits; }
+	uint64 GetNumMisses() const { return NumMisses; }
+	uint64 GetNumPrefetched() const { return NumPrefetched; }
+	int32 GetNumCachedPackages() const { return CachedSizes.Num(); }
+	void ResetCounters();
+
+private:
+	struct FCachedSize
+	{
+		FName SizeType;
+		int64 Size = 0;
+		bool HasKnownSize = false;
+	};
+
+	const FCachedSize* FindCachedSize(const FName& PackageName, const FName& SizeType) const;
+	void AddCachedSize(const FName& PackageName, const FName& SizeType, int64 Size, bool HasKnownSize);
+
+	IAssetManagerEditorModule& EditorModule;
+	const FAssetManagerEditorRegistrySource& RegistrySource;
+
+	// Rarely more than the two size types per package, a short array beats a map keyed by both names
+	TMap<FName, TArray<FCachedSize, TInlineAllocator<2>>> CachedSizes;
+
+	uint64 NumHits = 0;
+	uint64 NumMisses = 0;
+	uint64 NumPrefetched = 0;
+};
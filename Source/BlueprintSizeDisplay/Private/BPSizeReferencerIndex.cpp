@@ -0,0 +1,252 @@
+#include "BPSizeReferencerIndex.h"
+
+#include "BPSizeCondensation.h"
+
+void FBPSizeReferencerIndex::Update(FBPSizeGraph& Graph)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::UpdateReferencerIndex);
+
+	TArray<int32> changedPackages;
+	Graph.ConsumeReferencerChanges(changedPackages);
+	NumPackages = Graph.GetPackageNames().Num();
+
+	// Past that the patches cost more to look up than flattening everything again does
+	const bool hasTooManyPatches = PatchedReferencers.Num() + changedPackages.Num() > ReferencerOffsets.Num() / 8;
+	if (!IsBuilt || Generation != Graph.GetGeneration() || hasTooManyPatches)
+	{
+		Build(*Graph.GetSnapshot());
+		return;
+	}
+
+	for (const int32 packageIndex : changedPackages)
+	{
+		TArray<int32>& referencers = PatchedReferencers.FindOrAdd(packageIndex);
+		referencers.Reset();
+		for (const int32 referencerIndex : Graph.GetReferencers(packageIndex))
+		{
+			if (Graph.IsHardGameDependency(referencerIndex, packageIndex))
+			{
+				referencers.Add(referencerIndex);
+			}
+		}
+	}
+}
+
+void FBPSizeReferencerIndex::Build(const FBPSizeGraphSnapshot& Snapshot)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::BuildReferencerIndex);
+
+	IsBuilt = true;
+	Generation = Snapshot.Generation;
+	NumPackages = Snapshot.GetNumPackages();
+	PatchedReferencers.Reset();
+
+	auto forEachEdge = [&Snapshot](auto&& Visit)
+	{
+		for (int32 packageIndex = 0; packageIndex < Snapshot.GetNumPackages(); ++packageIndex)
+		{
+			for (int32 edge = Snapshot.DependencyOffsets[packageIndex]; edge < Snapshot.DependencyOffsets[packageIndex + 1]; ++edge)
+			{
+				if (BPSizeDependencyModes::IsHardGame(Snapshot.DependencyModes[edge]))
+				{
+					Visit(packageIndex, Snapshot.DependencyIndices[edge]);
+				}
+			}
+		}
+	};
+
+	// Counted first, so the referencers of every package land in one contiguous run
+	ReferencerOffsets.Reset();
+	ReferencerOffsets.SetNumZeroed(NumPackages + 1);
+	forEachEdge([this](int32 ReferencerIndex, int32 DependencyIndex) { ++ReferencerOffsets[DependencyIndex + 1]; });
+	for (int32 packageIndex = 0; packageIndex < NumPackages; ++packageIndex)
+	{
+		ReferencerOffsets[packageIndex + 1] += ReferencerOffsets[packageIndex];
+	}
+
+	ReferencerIndices.SetNumUninitialized(ReferencerOffsets[NumPackages]);
+	TArray<int32> nextReferencer(ReferencerOffsets.GetData(), NumPackages);
+	forEachEdge([this, &nextReferencer](int32 ReferencerIndex, int32 DependencyIndex) { ReferencerIndices[nextReferencer[DependencyIndex]++] = ReferencerIndex; });
+}
+
+template <typename FunctorType>
+void FBPSizeReferencerIndex::ForEachReferencer(int32 PackageIndex, FunctorType&& Functor) const
+{
+	if (const TArray<int32>* patchedReferencers = PatchedReferencers.Find(PackageIndex))
+	{
+		for (const int32 referencerIndex : *patchedReferencers)
+		{
+			Functor(referencerIndex);
+		}
+		return;
+	}
+
+	if (PackageIndex + 1 < ReferencerOffsets.Num())
+	{
+		for (int32 referencer = ReferencerOffsets[PackageIndex]; referencer < ReferencerOffsets[PackageIndex + 1]; ++referencer)
+		{
+			Functor(ReferencerIndices[referencer]);
+		}
+	}
+}
+
+void FBPSizeReferencerIndex::GatherReferencers(int32 TargetIndex, TArray<int32>& OutReferencers, TArray<int32>& OutNextHops) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::GatherReferencers);
+
+	OutReferencers.Reset();
+	OutNextHops.Reset();
+	if (!IsBuilt || TargetIndex == INDEX_NONE || TargetIndex >= NumPackages)
+	{
+		return;
+	}
+
+	// Breadth first, so the next hops make up the shortest paths. The output doubles as the queue.
+	TBitArray<> visited(false, NumPackages);
+	visited[TargetIndex] = true;
+
+	auto visit = [&visited, &OutReferencers, &OutNextHops](int32 ReferencerIndex, int32 NextHop)
+	{
+		if (!visited[ReferencerIndex])
+		{
+			visited[ReferencerIndex] = true;
+			OutReferencers.Add(ReferencerIndex);
+			OutNextHops.Add(NextHop);
+		}
+	};
+
+	ForEachReferencer(TargetIndex, [&visit, TargetIndex](int32 ReferencerIndex) { visit(ReferencerIndex, TargetIndex); });
+	for (int32 queueIndex = 0; queueIndex < OutReferencers.Num(); ++queueIndex)
+	{
+		const int32 packageIndex = OutReferencers[queueIndex];
+		ForEachReferencer(packageIndex, [&visit, packageIndex](int32 ReferencerIndex) { visit(ReferencerIndex, packageIndex); });
+	}
+}
+
+void FBPSizeReferencerIndex::CalculateContributions(const FBPSizeGraphSnapshot& Snapshot, int32 TargetIndex, TConstArrayView<int32> RootIndices, int32 SizeTypeIndex, TArray<FBPSizeContribution>& OutContributions) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(BPSize::CalculateContributions);
+
+	OutContributions.Reset(RootIndices.Num());
+	OutContributions.AddDefaulted(RootIndices.Num());
+	const int32 numPackages = Snapshot.GetNumPackages();
+	if (!IsBuilt || TargetIndex == INDEX_NONE || TargetIndex >= numPackages)
+	{
+		return;
+	}
+
+	auto forEachDependency = [&Snapshot](int32 PackageIndex, auto&& Visit)
+	{
+		const int32 firstEdge = Snapshot.Resolved[PackageIndex] ? Snapshot.DependencyOffsets[PackageIndex] : Snapshot.DependencyOffsets[PackageIndex + 1];
+		for (int32 edge = firstEdge; edge < Snapshot.DependencyOffsets[PackageIndex + 1]; ++edge)
+		{
+			if (BPSizeDependencyModes::IsHardGame(Snapshot.DependencyModes[edge]))
+			{
+				Visit(Snapshot.DependencyIndices[edge]);
+			}
+		}
+	};
+
+	// Whatever a root loses is in the closure of the target
+	TBitArray<> inTargetClosure(false, numPackages);
+	TArray<int32> targetClosure;
+	inTargetClosure[TargetIndex] = true;
+	targetClosure.Add(TargetIndex);
+	for (int32 queueIndex = 0; queueIndex < targetClosure.Num(); ++queueIndex)
+	{
+		forEachDependency(targetClosure[queueIndex], [&inTargetClosure, &targetClosure](int32 DependencyIndex)
+		{
+			if (!inTargetClosure[DependencyIndex])
+			{
+				inTargetClosure[DependencyIndex] = true;
+				targetClosure.Add(DependencyIndex);
+			}
+		});
+	}
+
+	// A path through the target never leaves its closure again, so a root reaches everything of its closure outside
+	// the target's without the target. What it keeps of the target's closure is what the edges coming in from outside reach.
+	TArray<TPair<int32, int32>> entryEdges;
+	for (const int32 packageIndex : targetClosure)
+	{
+		if (packageIndex == TargetIndex)
+		{
+			continue;
+		}
+
+		ForEachReferencer(packageIndex, [&inTargetClosure, &entryEdges, numPackages, packageIndex](int32 ReferencerIndex)
+		{
+			if (ReferencerIndex < numPackages && !inTargetClosure[ReferencerIndex])
+			{
+				entryEdges.Emplace(ReferencerIndex, packageIndex);
+			}
+		});
+	}
+
+	FBPSizeCondensation condensation;
+	condensation.Build(Snapshot, RootIndices);
+
+	const TArray<int64>& selfSizes = Snapshot.SelfSizes[SizeTypeIndex];
+	const TBitArray<>& knownSizes = Snapshot.KnownSizes[SizeTypeIndex];
+
+	// Shared by all the roots, only the kept packages have to be cleared again
+	TBitArray<> kept(false, numPackages);
+	TArray<int32> keptPackages;
+	auto keep = [&kept, &keptPackages, TargetIndex](int32 PackageIndex)
+	{
+		if (PackageIndex != TargetIndex && !kept[PackageIndex])
+		{
+			kept[PackageIndex] = true;
+			keptPackages.Add(PackageIndex);
+		}
+	};
+
+	for (int32 rootOrdinal = 0; rootOrdinal < RootIndices.Num(); ++rootOrdinal)
+	{
+		const int32 rootIndex = RootIndices[rootOrdinal];
+		if (rootIndex == INDEX_NONE || rootIndex >= numPackages)
+		{
+			continue;
+		}
+
+		const FBPSizeSparseBitSet& rootClosure = condensation.GetClosure(rootIndex);
+		if (!rootClosure.Contains(TargetIndex))
+		{
+			continue;
+		}
+
+		// A root inside the target's closure is on a cycle with the target and keeps itself
+		if (inTargetClosure[rootIndex])
+		{
+			keep(rootIndex);
+		}
+		for (const TPair<int32, int32>& entryEdge : entryEdges)
+		{
+			if (rootClosure.Contains(entryEdge.Key))
+			{
+				keep(entryEdge.Value);
+			}
+		}
+		for (int32 queueIndex = 0; queueIndex < keptPackages.Num(); ++queueIndex)
+		{
+			forEachDependency(keptPackages[queueIndex], keep);
+		}
+
+		FBPSizeContribution& contribution = OutContributions[rootOrdinal];
+		contribution.ReachesTarget = true;
+		for (const int32 packageIndex : targetClosure)
+		{
+			if (!kept[packageIndex])
+			{
+				contribution.Size += selfSizes[packageIndex];
+				contribution.HasKnownSize &= knownSizes[packageIndex];
+			}
+		}
+
+		for (const int32 packageIndex : keptPackages)
+		{
+			kept[packageIndex] = false;
+		}
+		keptPackages.Reset();
+	}
+}
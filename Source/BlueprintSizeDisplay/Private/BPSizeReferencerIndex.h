@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BPSizeGraph.h"
+
+// Part of a root's closure that goes away together with the target, the target included
+struct FBPSizeContribution
+{
+	int64 Size = 0;
+	bool HasKnownSize = true;
+	bool ReachesTarget = false;
+};
+
+// Hard game referencers of every package the size graph has resolved, flattened the same way the snapshot flattens
+// the dependencies. Answers "whose closure contains this package" with one walk over the reverse edges, without
+// asking the registry for referencers. Packages re-resolved after a save get their lists patched in place of the
+// flattened ones, the index is only flattened again once the patches make up a good part of it.
+class FBPSizeReferencerIndex
+{
+public:
+	// Catches up with the changes of the graph since the last update, rebuilds it after the graph was reset
+	void Update(FBPSizeGraph& Graph);
+
+	// Every package whose closure contains the target, the target itself excluded.
+	// OutNextHops matches OutReferencers, it's the package the referencer's shortest path to the target continues with.
+	void GatherReferencers(int32 TargetIndex, TArray<int32>& OutReferencers, TArray<int32>& OutNextHops) const;
+
+	// Contribution of the target to the closure of every root, in one pass over the target's closure and one
+	// condensation of the roots instead of a dominator tree per root. OutContributions matches RootIndices.
+	void CalculateContributions(const FBPSizeGraphSnapshot& Snapshot, int32 TargetIndex, TConstArrayView<int32> RootIndices, int32 SizeTypeIndex, TArray<FBPSizeContribution>& OutContributions) const;
+
+	int32 GetNumPatchedPackages() const { return PatchedReferencers.Num(); }
+
+	// The next update rebuilds the index
+	void Reset() { IsBuilt = false; }
+
+private:
+	void Build(const FBPSizeGraphSnapshot& Snapshot);
+
+	template <typename FunctorType>
+	void ForEachReferencer(int32 PackageIndex, FunctorType&& Functor) const;
+
+	bool IsBuilt = false;
+	int32 Generation = 0;
+	int32 NumPackages = 0;
+
+	// Referencers of package i are ReferencerIndices[ReferencerOffsets[i]] .. ReferencerIndices[ReferencerOffsets[i + 1] - 1]
+	TArray<int32> ReferencerOffsets;
+	TArray<int32> ReferencerIndices;
+
+	// Replace the flattened lists, packages added to the graph after the build only have these
+	TMap<int32, TArray<int32>> PatchedReferencers;
+};
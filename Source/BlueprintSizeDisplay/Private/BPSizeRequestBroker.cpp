@@ -0,0 +1,261 @@
+#include "BPSizeRequestBroker.h"
+
+namespace
+{
+	// Packages resolved between two looks at the clock
+	constexpr int32 ResolveSliceSize = 16;
+}
+
+FBPSizeRequestBroker::FBPSizeRequestBroker(FBPSizeGraph& InSizeGraph, const FAssetManagerEditorRegistrySource& InRegistrySource) :
+	SizeGraph(InSizeGraph),
+	RegistrySource(InRegistrySource)
+{
+}
+
+FBPSizeRequestBroker::~FBPSizeRequestBroker()
+{
+	DropRound();
+}
+
+const FBPSizeRequestBroker::FRequest& FBPSizeRequestBroker::Request(const FName& PackageName, const FName& SizeType, uint8 Modes)
+{
+	if (FRequest* pendingRequest = Requests.Find(PackageName))
+	{
+		pendingRequest->Modes |= Modes;
+		return *pendingRequest;
+	}
+
+	FRequest& request = Requests.Add(PackageName);
+	request.PackageName = PackageName;
+	request.SizeType = SizeType;
+	request.Modes = Modes;
+	request.StartTime = FPlatformTime::Seconds();
+	return request;
+}
+
+const FBPSizeRequestBroker::FRequest& FBPSizeRequestBroker::Restart(const FName& PackageName, const FName& SizeType, uint8 Modes)
+{
+	// The packages sized along with it are simply walked again, the graph still has everything resolved for them
+	DropRound();
+
+	const FRequest* pendingRequest = Requests.Find(PackageName);
+	const uint8 pendingModes = pendingRequest ? pendingRequest->Modes : 0;
+
+	FRequest& request = Requests.Add(PackageName);
+	request.PackageName = PackageName;
+	request.SizeType = SizeType;
+	request.Modes = Modes | pendingModes;
+	request.StartTime = FPlatformTime::Seconds();
+	return request;
+}
+
+void FBPSizeRequestBroker::Cancel(const FName& PackageName)
+{
+	Requests.Remove(PackageName);
+
+	// A round still sizing other packages keeps going, the result for this one is just not reported
+	if (Requests.IsEmpty())
+	{
+		DropRound();
+	}
+}
+
+void FBPSizeRequestBroker::CancelAll()
+{
+	Requests.Empty();
+	DropRound();
+}
+
+void FBPSizeRequestBroker::Tick(double EndTime, int32 NumThreads)
+{
+	if (!CurrentRound)
+	{
+		if (!Requests.IsEmpty())
+		{
+			LaunchRound(NumThreads);
+		}
+		return;
+	}
+
+	FRound& round = *CurrentRound;
+	if (round.PendingResolves.IsEmpty())
+	{
+		if (!round.Task.IsCompleted())
+		{
+			return;
+		}
+
+		const FRoundResult& result = round.Task.GetResult();
+		if (result.UnresolvedPackages.IsEmpty() && round.Generation == SizeGraph.GetGeneration())
+		{
+			// Whoever joined while the round was running gets its own round right away
+			FinishRound();
+			if (!Requests.IsEmpty())
+			{
+				LaunchRound(NumThreads);
+			}
+			return;
+		}
+
+		round.PendingResolves = result.UnresolvedPackages;
+	}
+
+	if (round.Generation != SizeGraph.GetGeneration())
+	{
+		// The graph got reset under us, the package indices in the result mean nothing anymore
+		LaunchRound(NumThreads);
+		return;
+	}
+
+	// Only the registry queries happen here, the walk itself stays on the background task
+	if (ResolvePendingPackages(EndTime))
+	{
+		LaunchRound(NumThreads);
+	}
+}
+
+void FBPSizeRequestBroker::LaunchRound(int32 NumThreads)
+{
+	DropRound();
+	if (Requests.IsEmpty())
+	{
+		return;
+	}
+
+	TUniquePtr<FRound> round = MakeUnique<FRound>();
+	Requests.GenerateKeyArray(round->PackageNames);
+
+	// Adding a size type resets the graph, so it has to happen before the generation is taken
+	for (const FName& packageName : round->PackageNames)
+	{
+		SizeGraph.FindOrAddSizeType(Requests[packageName].SizeType);
+	}
+
+	// Taken even when there is nothing to walk, a round of an older generation gets launched again
+	round->Generation = SizeGraph.GetGeneration();
+
+	if (!RegistrySource.HasRegistry())
+	{
+		// Nothing to walk, the task finishes right away with unknown sizes
+		const int32 numRoots = round->PackageNames.Num();
+		const int32 numSizeTypes = SizeGraph.GetSizeTypes().Num();
+		round->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [numRoots, numSizeTypes]()
+		{
+			FRoundResult noRegistryResult;
+			noRegistryResult.Closures.SetNum(numRoots);
+			for (FBPSizeClosureResult& closure : noRegistryResult.Closures)
+			{
+				closure.InitSizes(numSizeTypes, false);
+			}
+			return noRegistryResult;
+		});
+		CurrentRound = MoveTemp(round);
+		return;
+	}
+
+	// The union is walked in every mode any of the roots asks for, only hard game walks are split across threads
+	TArray<int32> rootIndices;
+	TArray<uint8> rootModes;
+	uint8 modes = 0;
+	rootIndices.Reserve(round->PackageNames.Num());
+	rootModes.Reserve(round->PackageNames.Num());
+	for (const FName& packageName : round->PackageNames)
+	{
+		rootIndices.Add(SizeGraph.FindOrAddPackage(packageName));
+
+		FRequest& request = Requests[packageName];
+		request.Generation = round->Generation;
+		++request.NumRounds;
+		rootModes.Add(request.Modes);
+		modes |= request.Modes;
+	}
+
+	TSharedRef<const FBPSizeGraphSnapshot, ESPMode::ThreadSafe> snapshot = SizeGraph.GetSnapshot();
+	TSharedRef<std::atomic<bool>, ESPMode::ThreadSafe> cancelled = round->Cancelled;
+
+	round->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [snapshot, rootIndices = MoveTemp(rootIndices), rootModes = MoveTemp(rootModes), cancelled, NumThreads, modes]()
+	{
+		// One walk over the union finds what any of the roots still misses, a package several of them share is walked once
+		FRoundResult result;
+		FBPSizeClosureResult unionClosure = snapshot->CalculateUnionClosure(rootIndices, &cancelled.Get(), NumThreads, modes);
+		if (unionClosure.WasCancelled || !unionClosure.UnresolvedPackages.IsEmpty())
+		{
+			result.UnresolvedPackages = MoveTemp(unionClosure.UnresolvedPackages);
+			return result;
+		}
+
+		if (rootIndices.Num() == 1)
+		{
+			result.Closures.Add(MoveTemp(unionClosure));
+			return result;
+		}
+
+		// Summed up from the condensed graph, every closure below a component is built once for all the roots
+		FBPSizeBatchResult batchResult = snapshot->CalculateClosures(rootIndices, true);
+		result.Closures = MoveTemp(batchResult.Closures);
+
+		// The condensation only follows hard game references, roots asking for other modes still get a walk of their own
+		for (int32 rootOrdinal = 0; rootOrdinal < rootIndices.Num(); ++rootOrdinal)
+		{
+			if (rootModes[rootOrdinal] != BPSizeDependencyModes::HardGame)
+			{
+				result.Closures[rootOrdinal] = snapshot->CalculateClosure(rootIndices[rootOrdinal], &cancelled.Get(), NumThreads, rootModes[rootOrdinal]);
+			}
+		}
+		return result;
+	});
+
+	CurrentRound = MoveTemp(round);
+}
+
+void FBPSizeRequestBroker::DropRound()
+{
+	// The task only holds on to its snapshot, so it's enough to tell it to stop
+	if (CurrentRound)
+	{
+		CurrentRound->Cancelled->store(true);
+		CurrentRound.Reset();
+	}
+}
+
+bool FBPSizeRequestBroker::ResolvePendingPackages(double EndTime)
+{
+	FRound& round = *CurrentRound;
+	while (round.NextPendingResolve < round.PendingResolves.Num())
+	{
+		if (EndTime > 0.0 && FPlatformTime::Seconds() >= EndTime)
+		{
+			return false;
+		}
+
+		const int32 sliceSize = FMath::Min(ResolveSliceSize, round.PendingResolves.Num() - round.NextPendingResolve);
+		SizeGraph.ResolvePackages(MakeArrayView(round.PendingResolves).Slice(round.NextPendingResolve, sliceSize));
+		round.NextPendingResolve += sliceSize;
+
+		for (const FName& packageName : round.PackageNames)
+		{
+			if (FRequest* request = Requests.Find(packageName))
+			{
+				request->NumResolvedPackages += sliceSize;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FBPSizeRequestBroker::FinishRound()
+{
+	// The callbacks may start new requests, those must not see the finished round
+	const TUniquePtr<FRound> round = MoveTemp(CurrentRound);
+	const FRoundResult& result = round->Task.GetResult();
+
+	for (int32 rootOrdinal = 0; rootOrdinal < round->PackageNames.Num(); ++rootOrdinal)
+	{
+		FRequest request;
+		if (result.Closures.IsValidIndex(rootOrdinal) && Requests.RemoveAndCopyValue(round->PackageNames[rootOrdinal], request))
+		{
+			OnRequestFinished.ExecuteIfBound(request, result.Closures[rootOrdinal]);
+		}
+	}
+}
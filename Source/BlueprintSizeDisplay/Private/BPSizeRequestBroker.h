@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManagerEditorModule.h"
+#include "BPSizeGraph.h"
+#include "Tasks/Task.h"
+
+#include <atomic>
+
+// Closure calculations in flight, one per package no matter how many toolbars and callers ask for it.
+// Every pending package is walked in the same round: one background task over one snapshot walks the union of their
+// closures, and the game thread resolves what any of them misses a slice per tick, every package once. Once the union
+// is resolved, the same task sums up every root from the condensed graph. Requests made while a round runs join the next one.
+class FBPSizeRequestBroker
+{
+public:
+	struct FRequest
+	{
+		FName PackageName;
+
+		// Every size type of the graph gets calculated, changes of the closure are sized in the one asked for last
+		FName SizeType;
+
+		// Mask of BPSizeDependencyModes, every caller's modes are walked
+		uint8 Modes = BPSizeDependencyModes::HardGame;
+
+		// Generation of the graph the result was walked in
+		int32 Generation = 0;
+		int32 NumResolvedPackages = 0;
+		int32 NumRounds = 0;
+		double StartTime = 0.0;
+	};
+
+	DECLARE_DELEGATE_TwoParams(FOnRequestFinished, const FRequest&, const FBPSizeClosureResult&);
+
+	FBPSizeRequestBroker(FBPSizeGraph& InSizeGraph, const FAssetManagerEditorRegistrySource& InRegistrySource);
+	~FBPSizeRequestBroker();
+
+	// Joins the calculation already pending for the package, or adds it to the next round.
+	// Modes a round already in flight doesn't walk only get walked by a later request.
+	const FRequest& Request(const FName& PackageName, const FName& SizeType, uint8 Modes);
+
+	// Whatever was walked for the package so far is outdated. The round in flight is dropped, its packages go into the next one.
+	const FRequest& Restart(const FName& PackageName, const FName& SizeType, uint8 Modes);
+
+	void Cancel(const FName& PackageName);
+	void CancelAll();
+
+	const FRequest* Find(const FName& PackageName) const { return Requests.Find(PackageName); }
+
+	// Resolves what the round in flight found missing until EndTime, then launches the next round.
+	// Finished requests are reported through OnRequestFinished and forgotten.
+	void Tick(double EndTime, int32 NumThreads);
+
+	FOnRequestFinished OnRequestFinished;
+
+private:
+	struct FRoundResult
+	{
+		// Of the union of the closures, the round is only finished once this is empty
+		TArray<int32> UnresolvedPackages;
+
+		// Matches the roots of the round
+		TArray<FBPSizeClosureResult> Closures;
+	};
+
+	struct FRound
+	{
+		TArray<FName> PackageNames;
+		int32 Generation = 0;
+
+		// Unresolved packages of the last walk, resolved a slice per tick before the next round launches
+		TArray<int32> PendingResolves;
+		int32 NextPendingResolve = 0;
+		TSharedRef<std::atomic<bool>, ESPMode::ThreadSafe> Cancelled = MakeShared<std::atomic<bool>, ESPMode::ThreadSafe>(false);
+		UE::Tasks::TTask<FRoundResult> Task;
+	};
+
+	void LaunchRound(int32 NumThreads);
+	void DropRound();
+
+	// Returns true once all the pending resolves of the round are done
+	bool ResolvePendingPackages(double EndTime);
+	void FinishRound();
+
+	FBPSizeGraph& SizeGraph;
+	const FAssetManagerEditorRegistrySource& RegistrySource;
+
+	TMap<FName, FRequest> Requests;
+	TUniquePtr<FRound> CurrentRound;
+};
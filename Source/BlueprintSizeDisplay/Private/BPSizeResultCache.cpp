@@ -0,0 +1,155 @@
+#include "BPSizeResultCache.h"
+
+#include "BPSizeStats.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	TAutoConsoleVariable<int32> CVarResultCacheBudgetKB(
+		TEXT("BPSize.ResultCacheBudgetKB"),
+		16 * 1024,
+		TEXT("How much memory the cached sizes and closures of packages may take, in KB. The least recently used packages are evicted first."));
+}
+
+FBPSizeResult* FBPSizeResultCache::Find(const FName& PackageName)
+{
+	FEntry* entry = Entries.Find(PackageName);
+	if (!entry)
+	{
+		++NumMisses;
+		return nullptr;
+	}
+
+	++NumHits;
+	Touch(*entry);
+	return &entry->Result;
+}
+
+FBPSizeResult& FBPSizeResultCache::FindOrAdd(const FName& PackageName)
+{
+	if (FBPSizeResult* existingResult = Find(PackageName))
+	{
+		return *existingResult;
+	}
+
+	FEntry& entry = Entries.Add(PackageName);
+	entry.Result.PackageName = PackageName;
+	entry.NumBytes = CalculateNumBytes(entry.Result);
+	NumBytes += entry.NumBytes;
+	Touch(entry);
+
+	return entry.Result;
+}
+
+FBPSizeResult* FBPSizeResultCache::Peek(const FName& PackageName)
+{
+	FEntry* entry = Entries.Find(PackageName);
+	return entry ? &entry->Result : nullptr;
+}
+
+void FBPSizeResultCache::Commit(const FName& PackageName)
+{
+	FEntry* entry = Entries.Find(PackageName);
+	if (!entry)
+	{
+		return;
+	}
+
+	NumBytes -= entry->NumBytes;
+	entry->NumBytes = CalculateNumBytes(entry->Result);
+	NumBytes += entry->NumBytes;
+	PeakBytes = FMath::Max(PeakBytes, NumBytes);
+
+	EvictToBudget();
+	UpdateStats();
+}
+
+void FBPSizeResultCache::Remove(const FName& PackageName)
+{
+	if (FEntry* entry = Entries.Find(PackageName))
+	{
+		RemoveEntry(PackageName, *entry);
+		UpdateStats();
+	}
+}
+
+void FBPSizeResultCache::Reset()
+{
+	Entries.Empty();
+	UseOrder.Empty();
+	NumBytes = 0;
+	UpdateStats();
+}
+
+void FBPSizeResultCache::ResetCounters()
+{
+	PeakBytes = NumBytes;
+	NumHits = 0;
+	NumMisses = 0;
+	NumEvictions = 0;
+}
+
+void FBPSizeResultCache::Touch(FEntry& Entry)
+{
+	if (Entry.UseNode)
+	{
+		if (Entry.UseNode == UseOrder.GetHead())
+		{
+			return;
+		}
+
+		UseOrder.RemoveNode(Entry.UseNode, false);
+		UseOrder.AddHead(Entry.UseNode);
+		return;
+	}
+
+	UseOrder.AddHead(Entry.Result.PackageName);
+	Entry.UseNode = UseOrder.GetHead();
+}
+
+void FBPSizeResultCache::RemoveEntry(const FName& PackageName, FEntry& Entry)
+{
+	NumBytes -= Entry.NumBytes;
+	UseOrder.RemoveNode(Entry.UseNode);
+	Entries.Remove(PackageName);
+}
+
+void FBPSizeResultCache::EvictToBudget()
+{
+	const SIZE_T budget = static_cast<SIZE_T>(FMath::Max(CVarResultCacheBudgetKB.GetValueOnGameThread(), 0)) * 1024;
+
+	// The most recently used entry stays even if it's over the budget on its own, it's the one being shown
+	while (NumBytes > budget && UseOrder.Num() > 1)
+	{
+		const FName leastRecentlyUsed = UseOrder.GetTail()->GetValue();
+		RemoveEntry(leastRecentlyUsed, Entries.FindChecked(leastRecentlyUsed));
+		++NumEvictions;
+	}
+}
+
+void FBPSizeResultCache::UpdateStats() const
+{
+	SET_MEMORY_STAT(STAT_BPSizeResultCacheBytes, NumBytes);
+	SET_DWORD_STAT(STAT_BPSizeResultCacheEntries, Entries.Num());
+}
+
+SIZE_T FBPSizeResultCache::CalculateNumBytes(const FBPSizeResult& Result)
+{
+	// The map slot and the node of the use order, plus whatever the entry allocated itself
+	SIZE_T numBytes = sizeof(FEntry) + sizeof(FName) + sizeof(TDoubleLinkedList<FName>::TDoubleLinkedListNode);
+	numBytes += Result.Sizes.GetAllocatedSize() + Result.InitialSizes.GetAllocatedSize() + Result.HasKnownSizes.GetAllocatedSize();
+	numBytes += Result.ClosureWords.GetAllocatedSize();
+	numBytes += Result.ModeClosures.GetAllocatedSize();
+	for (const FBPSizeModeClosure& modeClosure : Result.ModeClosures)
+	{
+		numBytes += modeClosure.Sizes.GetAllocatedSize() + modeClosure.HasKnownSizes.GetAllocatedSize();
+	}
+
+	if (Result.Change.IsSet())
+	{
+		numBytes += Result.Change->AddedEdges.GetAllocatedSize();
+		numBytes += Result.Change->RemovedPackages.GetAllocatedSize();
+	}
+
+	return numBytes;
+}
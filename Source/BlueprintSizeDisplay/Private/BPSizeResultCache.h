@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BPSizeGraph.h"
+#include "Containers/List.h"
+
+// What the checker remembers about a package between calculations.
+// One calculation sizes every size type of the graph, so the sizes are kept side by side, indexed like FBPSizeGraph::GetSizeTypes.
+struct FBPSizeResult
+{
+	FName PackageName;
+	bool IsDirty = true;
+	bool HasBeenCalculated = false;
+	FBPSizeTypeSizes Sizes;
+	FBPSizeTypeSizes InitialSizes;
+	FBPSizeTypeFlags HasKnownSizes;
+
+	// The closures of every dependency mode, when the calculation walked them
+	FBPSizeModeClosures ModeClosures;
+
+	// The last closure, to tell what changed at the next calculation, and that change
+	int32 ClosureGeneration = 0;
+	TArray<uint64> ClosureWords;
+	TOptional<FBPSizeClosureChange> Change;
+
+	// Size types added to the graph after the last calculation have no size yet
+	bool HasSize(int32 SizeTypeIndex) const { return HasBeenCalculated && Sizes.IsValidIndex(SizeTypeIndex); }
+};
+
+// Results per package, within a memory budget. The least recently used ones are evicted first.
+// Entries are only charged for their memory when they are committed, so commit after changing one.
+class FBPSizeResultCache
+{
+public:
+	// Both count as a use of the entry
+	FBPSizeResult* Find(const FName& PackageName);
+	FBPSizeResult& FindOrAdd(const FName& PackageName);
+
+	// Doesn't count as a use
+	FBPSizeResult* Peek(const FName& PackageName);
+
+	// Charges the entry for what it holds now and evicts until the cache fits the budget again.
+	// References to other entries don't survive this.
+	void Commit(const FName& PackageName);
+
+	void Remove(const FName& PackageName);
+	void Reset();
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+	SIZE_T GetNumBytes() const { return NumBytes; }
+	SIZE_T GetPeakBytes() const { return PeakBytes; }
+	uint64 GetNumHits() const { return NumHits; }
+	uint64 GetNumMisses() const { return NumMisses; }
+	uint64 GetNumEvictions() const { return NumEvictions; }
+	void ResetCounters();
+
+private:
+	struct FEntry
+	{
+		FBPSizeResult Result;
+		SIZE_T NumBytes = 0;
+		TDoubleLinkedList<FName>::TDoubleLinkedListNode* UseNode = nullptr;
+	};
+
+	void Touch(FEntry& Entry);
+	void RemoveEntry(const FName& PackageName, FEntry& Entry);
+	void EvictToBudget();
+	void UpdateStats() const;
+
+	static SIZE_T CalculateNumBytes(const FBPSizeResult& Result);
+
+	TMap<FName, FEntry> Entries;
+
+	// Most recently used first
+	TDoubleLinkedList<FName> UseOrder;
+
+	SIZE_T NumBytes = 0;
+	SIZE_T PeakBytes = 0;
+	uint64 NumHits = 0;
+	uint64 NumMisses = 0;
+	uint64 NumEvictions = 0;
+};
@@ -0,0 +1,137 @@
+#include "BPSizeStats.h"
+
+#include "HAL/IConsoleManager.h"
+
+#include <atomic>
+
+DEFINE_STAT(STAT_BPSizeGather);
+DEFINE_STAT(STAT_BPSizeFinalize);
+DEFINE_STAT(STAT_BPSizeFormat);
+DEFINE_STAT(STAT_BPSizeResolve);
+DEFINE_STAT(STAT_BPSizeSnapshot);
+DEFINE_STAT(STAT_BPSizeClosureWalk);
+
+DEFINE_STAT(STAT_BPSizeNodesVisited);
+DEFINE_STAT(STAT_BPSizeDependencyQueries);
+DEFINE_STAT(STAT_BPSizeReferencerQueries);
+DEFINE_STAT(STAT_BPSizeSizeLookups);
+DEFINE_STAT(STAT_BPSizeCacheHits);
+DEFINE_STAT(STAT_BPSizeCacheMisses);
+DEFINE_STAT(STAT_BPSizeSizesPrefetched);
+DEFINE_STAT(STAT_BPSizeBytesAllocated);
+DEFINE_STAT(STAT_BPSizeResultCacheBytes);
+DEFINE_STAT(STAT_BPSizeResultCacheEntries);
+
+namespace
+{
+	// Older calculations of a package are dropped, the slowest ones are what's interesting anyway
+	constexpr int32 MaxCalculationsPerPackage = 16;
+
+	std::atomic<int64> Totals[static_cast<int32>(FBPSizeStats::ECounter::Num)];
+
+	TMap<FName, TArray<FBPSizeStats::FCalculation>> CalculationHistory;
+
+	const TCHAR* GetCounterName(FBPSizeStats::ECounter Counter)
+	{
+		switch (Counter)
+		{
+		case FBPSizeStats::ECounter::NodesVisited: return TEXT("Nodes visited");
+		case FBPSizeStats::ECounter::DependencyQueries: return TEXT("Dependency queries");
+		case FBPSizeStats::ECounter::ReferencerQueries: return TEXT("Referencer queries");
+		case FBPSizeStats::ECounter::SizeLookups: return TEXT("Size lookups");
+		case FBPSizeStats::ECounter::CacheHits: return TEXT("Size cache hits");
+		case FBPSizeStats::ECounter::CacheMisses: return TEXT("Size cache misses");
+		case FBPSizeStats::ECounter::SizesPrefetched: return TEXT("Sizes prefetched");
+		case FBPSizeStats::ECounter::BytesAllocated: return TEXT("Bytes allocated");
+		default: return TEXT("?");
+		}
+	}
+
+	FAutoConsoleCommand StatsCommand(
+		TEXT("BPSize.Stats"),
+		TEXT("Logs the size calculation counters, the timing history of every package and the slowest calculations. Usage: BPSize.Stats [NumSlowest|reset]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			if (Args.IsValidIndex(0) && Args[0] == TEXT("reset"))
+			{
+				FBPSizeStats::Reset();
+				return;
+			}
+
+			FBPSizeStats::Dump(Args.IsValidIndex(0) ? FCString::Atoi(*Args[0]) : 10);
+		}));
+}
+
+void FBPSizeStats::Increment(ECounter Counter, int64 Amount)
+{
+	Totals[static_cast<int32>(Counter)].fetch_add(Amount, std::memory_order_relaxed);
+
+	switch (Counter)
+	{
+	case ECounter::NodesVisited: INC_DWORD_STAT_BY(STAT_BPSizeNodesVisited, Amount); break;
+	case ECounter::DependencyQueries: INC_DWORD_STAT_BY(STAT_BPSizeDependencyQueries, Amount); break;
+	case ECounter::ReferencerQueries: INC_DWORD_STAT_BY(STAT_BPSizeReferencerQueries, Amount); break;
+	case ECounter::SizeLookups: INC_DWORD_STAT_BY(STAT_BPSizeSizeLookups, Amount); break;
+	case ECounter::CacheHits: INC_DWORD_STAT_BY(STAT_BPSizeCacheHits, Amount); break;
+	case ECounter::CacheMisses: INC_DWORD_STAT_BY(STAT_BPSizeCacheMisses, Amount); break;
+	case ECounter::SizesPrefetched: INC_DWORD_STAT_BY(STAT_BPSizeSizesPrefetched, Amount); break;
+	case ECounter::BytesAllocated: INC_MEMORY_STAT_BY(STAT_BPSizeBytesAllocated, Amount); break;
+	default: break;
+	}
+}
+
+void FBPSizeStats::AddCalculation(FCalculation&& Calculation)
+{
+	check(IsInGameThread());
+
+	TArray<FCalculation>& packageHistory = CalculationHistory.FindOrAdd(Calculation.PackageName);
+	if (packageHistory.Num() >= MaxCalculationsPerPackage)
+	{
+		packageHistory.RemoveAt(0, 1, false);
+	}
+	packageHistory.Add(MoveTemp(Calculation));
+}
+
+void FBPSizeStats::Dump(int32 NumSlowest)
+{
+	for (int32 counter = 0; counter < static_cast<int32>(ECounter::Num); ++counter)
+	{
+		UE_LOG(LogTemp, Display, TEXT("%s: %lld"), GetCounterName(static_cast<ECounter>(counter)), Totals[counter].load(std::memory_order_relaxed));
+	}
+
+	TArray<const FCalculation*> allCalculations;
+	for (const TPair<FName, TArray<FCalculation>>& packageHistory : CalculationHistory)
+	{
+		FString timings;
+		for (const FCalculation& calculation : packageHistory.Value)
+		{
+			timings += FString::Printf(TEXT(" %.1f"), calculation.Seconds * 1000.0);
+			allCalculations.Add(&calculation);
+		}
+		UE_LOG(LogTemp, Display, TEXT("%s (ms):%s"), *packageHistory.Key.ToString(), *timings);
+	}
+
+	allCalculations.Sort([](const FCalculation& A, const FCalculation& B) { return A.Seconds > B.Seconds; });
+
+	UE_LOG(LogTemp, Display, TEXT("Slowest %d calculations:"), FMath::Min(NumSlowest, allCalculations.Num()));
+	for (int32 ordinal = 0; ordinal < NumSlowest && ordinal < allCalculations.Num(); ++ordinal)
+	{
+		const FCalculation& calculation = *allCalculations[ordinal];
+		UE_LOG(LogTemp, Display, TEXT("  %.1f ms  %s (%s), %d packages in %d rounds, at %s"),
+			calculation.Seconds * 1000.0,
+			*calculation.PackageName.ToString(),
+			*calculation.SizeType.ToString(),
+			calculation.NumPackages,
+			calculation.NumRounds,
+			*calculation.FinishTime.ToString());
+	}
+}
+
+void FBPSizeStats::Reset()
+{
+	for (std::atomic<int64>& total : Totals)
+	{
+		total.store(0, std::memory_order_relaxed);
+	}
+	CalculationHistory.Empty();
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("Blueprint Size Display"), STATGROUP_BPSize, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gather"), STAT_BPSizeGather, STATGROUP_BPSize, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Finalize"), STAT_BPSizeFinalize, STATGROUP_BPSize, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Format"), STAT_BPSizeFormat, STATGROUP_BPSize, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Resolve"), STAT_BPSizeResolve, STATGROUP_BPSize, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Snapshot"), STAT_BPSizeSnapshot, STATGROUP_BPSize, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Closure walk"), STAT_BPSizeClosureWalk, STATGROUP_BPSize, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes visited"), STAT_BPSizeNodesVisited, STATGROUP_BPSize, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Dependency queries"), STAT_BPSizeDependencyQueries, STATGROUP_BPSize, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Referencer queries"), STAT_BPSizeReferencerQueries, STATGROUP_BPSize, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Size lookups"), STAT_BPSizeSizeLookups, STATGROUP_BPSize, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Size cache hits"), STAT_BPSizeCacheHits, STATGROUP_BPSize, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Size cache misses"), STAT_BPSizeCacheMisses, STATGROUP_BPSize, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Sizes prefetched"), STAT_BPSizeSizesPrefetched, STATGROUP_BPSize, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Bytes allocated"), STAT_BPSizeBytesAllocated, STATGROUP_BPSize, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Result cache"), STAT_BPSizeResultCacheBytes, STATGROUP_BPSize, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Result cache entries"), STAT_BPSizeResultCacheEntries, STATGROUP_BPSize, );
+
+// Totals of the counters since the editor started, next to the per frame STAT ones, and a history of finished calculations.
+// Backs the BPSize.Stats console command.
+class FBPSizeStats
+{
+public:
+	enum class ECounter : uint8
+	{
+		NodesVisited,
+		DependencyQueries,
+		ReferencerQueries,
+		SizeLookups,
+		CacheHits,
+		CacheMisses,
+
+		// Looked up a whole frontier at a time, not counted as misses, the same as the size provider counts them
+		SizesPrefetched,
+		BytesAllocated,
+		Num
+	};
+
+	struct FCalculation
+	{
+		FName PackageName;
+		FName SizeType;
+		double Seconds = 0.0;
+		int32 NumPackages = 0;
+		int32 NumRounds = 0;
+		FDateTime FinishTime;
+	};
+
+	// Safe to call from any thread
+	static void Increment(ECounter Counter, int64 Amount = 1);
+
+	// Game thread only
+	static void AddCalculation(FCalculation&& Calculation);
+
+	static void Dump(int32 NumSlowest);
+	static void Reset();
+};
@@ -11,6 +11,12 @@
 
 void FBlueprintSizeDisplayModule::StartupModule()
 {
+	if (IsRunningCommandlet())
+	{
+		// The toolbar widget is of no use to the audit commandlet
+		return;
+	}
+
 	IAssetRegistry* assetRegistry = IAssetRegistry::Get();
 
 	static FDelegateHandle runHandle; 
@@ -0,0 +1,219 @@
+#include "BPSizeChecker.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBPSizeGatherTest, "BlueprintSizeDisplay.GatherDependencies", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+namespace
+{
+	FName MakeTestPackageName(const TCHAR* Name, int32 Number = 0)
+	{
+		return FName(*FString::Printf(TEXT("/Game/BPSizeGatherTest/%s%d"), Name, Number));
+	}
+}
+
+bool FBPSizeGatherTest::RunTest(const FString& Parameters)
+{
+	// Package name to its references and its size, standing in for the registry
+	struct FSyntheticGraph
+	{
+		TMap<FName, TArray<FName>> References;
+		TMap<FName, int64> Sizes;
+
+		void Add(const FName& PackageName, int64 Size, TArray<FName> PackageReferences = {})
+		{
+			Sizes.Add(PackageName, Size);
+			References.Add(PackageName, MoveTemp(PackageReferences));
+		}
+	};
+
+	struct FGatherResult
+	{
+		UBPSizeChecker::FSizeTreeBuild Build;
+		TMap<FAssetIdentifier, UBPSizeChecker::FVisitedTreeMapNode> VisitedAssetIdentifiers;
+		TSharedPtr<FTreeMapNodeData> RootNode;
+		TSharedPtr<FTreeMapNodeData> SharedRootNode;
+		int32 NumAssetsWhichFailedToLoad = 0;
+
+		FTreeMapNodeData* FindNode(const FName& PackageName) const
+		{
+			const UBPSizeChecker::FVisitedTreeMapNode* visitedNode = VisitedAssetIdentifiers.Find(FAssetIdentifier(PackageName));
+			return visitedNode ? visitedNode->Node.Get() : nullptr;
+		}
+
+		// The nodes hold their children, releasing a long chain from its root would recurse once per level
+		~FGatherResult()
+		{
+			if (!RootNode)
+			{
+				return;
+			}
+
+			TArray<TSharedPtr<FTreeMapNodeData>> nodes;
+			nodes.Add(RootNode);
+			for (int32 nodeOrdinal = 0; nodeOrdinal < nodes.Num(); ++nodeOrdinal)
+			{
+				nodes.Append(nodes[nodeOrdinal]->Children);
+			}
+			for (const TSharedPtr<FTreeMapNodeData>& node : nodes)
+			{
+				node->Children.Empty();
+			}
+		}
+	};
+
+	auto gather = [](const FSyntheticGraph& Graph, const TArray<FName>& Roots, FGatherResult& OutResult)
+	{
+		OutResult.RootNode = MakeShareable(new FTreeMapNodeData());
+		for (const FName& root : Roots)
+		{
+			OutResult.Build.RootAssetIdentifiers.Add(FAssetIdentifier(root));
+		}
+
+		UBPSizeChecker::GatherDependencies(OutResult.Build, OutResult.VisitedAssetIdentifiers, FPrimaryAssetId(), OutResult.RootNode, OutResult.SharedRootNode, OutResult.NumAssetsWhichFailedToLoad,
+			[&Graph](const FAssetIdentifier& AssetIdentifier, const FPrimaryAssetId& FilterPrimaryAsset, UBPSizeChecker::FNodeSizeMapData& NodeSizeMapData,
+				TArray<FAssetIdentifier, TMemStackAllocator<>>& ReferencedAssetIdentifiers, FPrimaryAssetId& ChildFilterPrimaryAsset)
+			{
+				const TArray<FName>* references = Graph.References.Find(AssetIdentifier.PackageName);
+				NodeSizeMapData.bIsValid = references != nullptr;
+				NodeSizeMapData.PackageName = AssetIdentifier.PackageName;
+				NodeSizeMapData.AssetName = AssetIdentifier.PackageName;
+				NodeSizeMapData.AssetSize = Graph.Sizes.FindRef(AssetIdentifier.PackageName);
+				NodeSizeMapData.bHasKnownSize = references != nullptr;
+
+				if (references)
+				{
+					for (const FName& reference : *references)
+					{
+						ReferencedAssetIdentifiers.Add(FAssetIdentifier(reference));
+					}
+				}
+			});
+	};
+
+	auto finalize = [](FGatherResult& Result, int32& OutTotalAssetCount, SIZE_T& OutTotalSize)
+	{
+		OutTotalAssetCount = 0;
+		OutTotalSize = 0;
+		bool anyUnknownSizes = false;
+		UBPSizeChecker::FinalizeNodesRecursively(Result.Build, Result.RootNode, Result.SharedRootNode, OutTotalAssetCount, OutTotalSize, anyUnknownSizes);
+	};
+
+	// Far deeper than the game thread could recurse
+	{
+		constexpr int32 ChainLength = 100000;
+
+		FSyntheticGraph graph;
+		for (int32 linkIndex = 0; linkIndex < ChainLength; ++linkIndex)
+		{
+			TArray<FName> references;
+			if (linkIndex + 1 < ChainLength)
+			{
+				references.Add(MakeTestPackageName(TEXT("Chain"), linkIndex + 1));
+			}
+			graph.Add(MakeTestPackageName(TEXT("Chain"), linkIndex), linkIndex + 1, MoveTemp(references));
+		}
+
+		FGatherResult result;
+		gather(graph, { MakeTestPackageName(TEXT("Chain")) }, result);
+
+		TestEqual(TEXT("Chain: every link is visited"), result.VisitedAssetIdentifiers.Num(), ChainLength);
+		TestEqual(TEXT("Chain: no asset failed to load"), result.NumAssetsWhichFailedToLoad, 0);
+		TestFalse(TEXT("Chain: nothing is shared"), result.SharedRootNode.IsValid());
+
+		int64 totalSize = 0;
+		for (const TPair<TSharedRef<FTreeMapNodeData>, UBPSizeChecker::FNodeSizeMapData>& nodeData : result.Build.NodeSizeMapDataMap)
+		{
+			totalSize += nodeData.Value.AssetSize;
+		}
+		TestEqual(TEXT("Chain: total size"), totalSize, int64(ChainLength) * (ChainLength + 1) / 2);
+
+		// Every link hangs below the one referencing it
+		int32 depth = 0;
+		const FTreeMapNodeData* node = result.RootNode.Get();
+		while (node->Children.Num() == 1)
+		{
+			node = node->Children[0].Get();
+			++depth;
+		}
+		TestEqual(TEXT("Chain: depth of the tree"), depth, ChainLength);
+		TestTrue(TEXT("Chain: last link is the leaf"), node == result.FindNode(MakeTestPackageName(TEXT("Chain"), ChainLength - 1)));
+	}
+
+	// A diamond below a single root-level asset stays where it was found first
+	{
+		FSyntheticGraph graph;
+		graph.Add(MakeTestPackageName(TEXT("Top")), 1, { MakeTestPackageName(TEXT("Left")), MakeTestPackageName(TEXT("Right")) });
+		graph.Add(MakeTestPackageName(TEXT("Left")), 2, { MakeTestPackageName(TEXT("Bottom")) });
+		graph.Add(MakeTestPackageName(TEXT("Right")), 4, { MakeTestPackageName(TEXT("Bottom")) });
+		graph.Add(MakeTestPackageName(TEXT("Bottom")), 8, { MakeTestPackageName(TEXT("Leaf")) });
+		graph.Add(MakeTestPackageName(TEXT("Leaf")), 16);
+
+		FGatherResult result;
+		gather(graph, { MakeTestPackageName(TEXT("Top")) }, result);
+
+		TestFalse(TEXT("Diamond: nothing is shared within one root-level asset"), result.SharedRootNode.IsValid());
+		TestTrue(TEXT("Diamond: bottom stays below the first referencer"),
+			result.FindNode(MakeTestPackageName(TEXT("Bottom")))->Parent == result.FindNode(MakeTestPackageName(TEXT("Left"))));
+		TestTrue(TEXT("Diamond: leaf stays below the bottom"),
+			result.FindNode(MakeTestPackageName(TEXT("Leaf")))->Parent == result.FindNode(MakeTestPackageName(TEXT("Bottom"))));
+
+		int32 totalAssetCount = 0;
+		SIZE_T totalSize = 0;
+		finalize(result, totalAssetCount, totalSize);
+		TestEqual(TEXT("Diamond: asset count"), totalAssetCount, 5);
+		TestEqual(TEXT("Diamond: total size"), int64(totalSize), int64(31));
+	}
+
+	// A diamond across two root-level assets moves the shared part into the *SHARED* group
+	{
+		FSyntheticGraph graph;
+		graph.Add(MakeTestPackageName(TEXT("Root"), 1), 1, { MakeTestPackageName(TEXT("Middle"), 1) });
+		graph.Add(MakeTestPackageName(TEXT("Root"), 2), 2, { MakeTestPackageName(TEXT("Middle"), 2) });
+		graph.Add(MakeTestPackageName(TEXT("Middle"), 1), 4, { MakeTestPackageName(TEXT("Shared")) });
+		graph.Add(MakeTestPackageName(TEXT("Middle"), 2), 8, { MakeTestPackageName(TEXT("Shared")) });
+		graph.Add(MakeTestPackageName(TEXT("Shared")), 16, { MakeTestPackageName(TEXT("Leaf")) });
+		graph.Add(MakeTestPackageName(TEXT("Leaf")), 32);
+
+		FGatherResult result;
+		gather(graph, { MakeTestPackageName(TEXT("Root"), 1), MakeTestPackageName(TEXT("Root"), 2) }, result);
+
+		if (TestTrue(TEXT("Shared diamond: the shared group exists"), result.SharedRootNode.IsValid()))
+		{
+			TestTrue(TEXT("Shared diamond: the shared group hangs below the tree root"), result.SharedRootNode->Parent == result.RootNode.Get());
+			TestTrue(TEXT("Shared diamond: the shared package moved into the group"),
+				result.FindNode(MakeTestPackageName(TEXT("Shared")))->Parent == result.SharedRootNode.Get());
+			TestTrue(TEXT("Shared diamond: the shared package keeps its subtree"),
+				result.FindNode(MakeTestPackageName(TEXT("Leaf")))->Parent == result.FindNode(MakeTestPackageName(TEXT("Shared"))));
+			TestEqual(TEXT("Shared diamond: only the shared package is in the group"), result.SharedRootNode->Children.Num(), 1);
+		}
+
+		int32 totalAssetCount = 0;
+		SIZE_T totalSize = 0;
+		finalize(result, totalAssetCount, totalSize);
+		TestEqual(TEXT("Shared diamond: asset count"), totalAssetCount, 6);
+		TestEqual(TEXT("Shared diamond: total size"), int64(totalSize), int64(63));
+		if (result.SharedRootNode.IsValid())
+		{
+			TestTrue(TEXT("Shared diamond: the group is labeled"), result.SharedRootNode->Name.StartsWith(TEXT("*SHARED*")));
+		}
+	}
+
+	// Root-level assets referencing each other are never moved into the *SHARED* group
+	{
+		FSyntheticGraph graph;
+		graph.Add(MakeTestPackageName(TEXT("Root"), 1), 1, { MakeTestPackageName(TEXT("Root"), 2) });
+		graph.Add(MakeTestPackageName(TEXT("Root"), 2), 2);
+
+		FGatherResult result;
+		gather(graph, { MakeTestPackageName(TEXT("Root"), 1), MakeTestPackageName(TEXT("Root"), 2) }, result);
+
+		TestFalse(TEXT("Referenced root: nothing is shared"), result.SharedRootNode.IsValid());
+		TestEqual(TEXT("Referenced root: both roots are visited once"), result.VisitedAssetIdentifiers.Num(), 2);
+	}
+
+	return true;
+}
+
+#endif